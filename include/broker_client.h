@@ -0,0 +1,78 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+
+#include <file_access.h>
+#include <file_upload.h>
+
+/*
+ * Socket of the GenCP broker, ALVIUM_BROKER_SOCKET or
+ * /run/alvium_file_access/broker.sock. An empty ALVIUM_BROKER_SOCKET
+ * makes clients always access the cameras directly.
+ */
+std::optional<std::filesystem::path> brokerSocketPath();
+
+struct BrokerReadOptions {
+    std::string entry;      /* archive entry to read instead of the file contents */
+    bool useCache = false;  /* see readContentCached */
+};
+
+/*
+ * Connection to a running broker (see gencp_broker.h). Requests are
+ * synchronous, file data is exchanged through shared memory.
+ */
+class BrokerClient {
+public:
+    /* Returns std::nullopt if no broker is listening */
+    static std::optional<BrokerClient> connect();
+    static std::optional<BrokerClient> connect(const std::filesystem::path &socketPath);
+
+    BrokerClient(BrokerClient &&other);
+    BrokerClient(const BrokerClient &other) = delete;
+
+    ~BrokerClient();
+
+    int readRegister(int subdev, uint64_t addr, uint8_t *buffer, size_t length);
+    int writeRegister(int subdev, uint64_t addr, const uint8_t *buffer, size_t length);
+
+    /*
+     * Same output as readContent, or the archive entry in options. The
+     * data is passed to sink straight from the shared buffer.
+     */
+    ssize_t readContent(int subdev, FileSelector selector, const FileSink &sink,
+                        const BrokerReadOptions &options = {}, bool *cached = nullptr);
+
+    /*
+     * Returns the number of bytes stored on the camera. The broker reports
+     * the progress of every chunk, and a cancel is passed on to it.
+     */
+    ssize_t upload(int subdev, FileSelector selector, const uint8_t *data, size_t length,
+                   const UploadOptions &options, UploadResult &result, const TransferControl &control = {});
+
+    /* Counters of the broker's session with the camera */
+    int stats(int subdev, GenCPStats &stats);
+private:
+    explicit BrokerClient(int socket);
+
+    int m_socket;
+};
@@ -0,0 +1,55 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies Gmbh
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <gencp.h>
+
+/* An Alvium subdev found in sysfs */
+struct AlviumCamera {
+    int subdev;
+    std::string name;                   /* v4l2 subdev name, e.g. "alvium 6-003c" */
+    std::filesystem::path devicePath;   /* sysfs directory holding fw_transfer */
+    std::string serial;                 /* only filled in if requested */
+};
+
+/*
+ * Scan /sys/class/video4linux once for subdevs with an fw_transfer
+ * attribute. Sysfs is all that is read, unless withSerial is set. Then
+ * every camera is opened to read its serial number, or asked through the
+ * broker if one is running. Sorted by subdev index.
+ */
+std::vector<AlviumCamera> discoverCameras(bool withSerial = false);
+
+/* Device serial number from the GenCP bootstrap registers */
+std::optional<std::string> readSerialNumber(AlviumGenCP &gencp);
+
+/*
+ * Turn a camera target into subdev indices. A target is a subdev index,
+ * "all" for every discovered camera or "sn:<serial>" for the camera with
+ * that serial number. Returns an empty list if nothing matches.
+ */
+std::vector<int> resolveCameraTarget(const std::string &target);
+
+/* Like resolveCameraTarget, but the target has to match exactly one camera */
+std::optional<int> resolveSingleCamera(const std::string &target);
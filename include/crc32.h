@@ -0,0 +1,54 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * CRC-32 (IEEE 802.3, as used by zlib). Pass the previous result as crc
+ * to continue over the next block of data.
+ */
+uint32_t crc32(const uint8_t *data, size_t length, uint32_t crc = 0);
+
+/*
+ * JAMCRC, the CRC-32 variant without final inversion used by GenCP. The
+ * result is the CRC state, pass it as state to continue over the next
+ * block of data. Same results as CRC32::JAMCRC::calc.
+ */
+static constexpr uint32_t JamcrcInit = 0xFFFFFFFF;
+
+uint32_t jamcrc(const uint8_t *data, size_t length, uint32_t state = JamcrcInit);
+
+/* Portable slice-by-8 implementation, jamcrc() uses it if the CPU offers no CRC instructions */
+uint32_t jamcrcPortable(const uint8_t *data, size_t length, uint32_t state = JamcrcInit);
+
+/* Name of the implementation jamcrc() dispatches to on this CPU */
+const char *jamcrcImplementation();
+
+/* Bitwise update for constant data, evaluated at compile time */
+constexpr uint32_t jamcrcByte(uint32_t state, uint8_t byte)
+{
+    state ^= byte;
+
+    for (int bit = 0; bit < 8; bit++)
+        state = (state >> 1) ^ (0xEDB88320 & (0 - (state & 1)));
+
+    return state;
+}
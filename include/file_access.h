@@ -19,6 +19,13 @@
 #pragma once
 
 
+#include <atomic>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+#include <cstdio>
+
 #include <gencp.h>
 
 
@@ -31,24 +38,105 @@ enum class FileOpenMode : uint8_t {
     Write = 2,
 };
 
+struct FileRange {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct TransferProgress {
+    size_t done;
+    size_t total;
+    double bytesPerSecond;
+};
+
+/*
+ * Optional hooks into a transfer. Both are checked after every file
+ * access chunk, a cancelled transfer stops there and returns -ECANCELED.
+ */
+struct TransferControl {
+    std::function<void(const TransferProgress &progress)> progress;
+    const std::atomic<bool> *cancelled = nullptr;
+};
+
+/*
+ * Receives the file contents chunk by chunk. A negative return value
+ * aborts the transfer and is returned by File::read.
+ */
+using FileSink = std::function<int(const uint8_t *data, size_t length)>;
+
+/* Sink writing everything to fd */
+FileSink fileDescriptorSink(int fd);
+
 class File {
 public:
     static std::optional<File> open(AlviumGenCP &gencp, FileSelector selector, FileOpenMode openMode);
     static int remove(AlviumGenCP &gencp, FileSelector selector);
+    /*
+     * Open for writing to change the file in place with pwrite. Some
+     * firmware truncates a file opened for writing, so this fails unless
+     * the file still has the expected length afterwards.
+     */
+    static std::optional<File> openInPlace(AlviumGenCP &gencp, FileSelector selector, size_t expectedLength);
 
     File(const File &other);
 
     ~File();
 
-    int write(const uint8_t *data, size_t length, bool showProgress = false);
+    int write(const uint8_t *data, size_t length, const TransferControl &control = {});
+    /*
+     * Write length bytes at offset, overwriting or extending the file.
+     * Fails if the device does not accept the offset on a file opened
+     * for writing.
+     */
+    ssize_t pwrite(uint32_t offset, const uint8_t *data, size_t length);
     ssize_t read(uint8_t *data, size_t maxLength);
 
+    /* Stream the file through a buffer of one file access chunk */
+    ssize_t read(const FileSink &sink, const TransferControl &control = {});
+    ssize_t read(int fd);
+    ssize_t read(std::ostream &stream);
+
+    /* Read up to length bytes starting at offset, only the requested range is transferred */
+    ssize_t pread(uint32_t offset, uint8_t *data, size_t length);
+
+    /* Read cursor shared by all copies of this File, see lseek(2) for whence */
+    off_t seek(off_t offset, int whence = SEEK_SET);
+    off_t tell() const;
+    /* Read up to length bytes at the cursor and advance it */
+    ssize_t readNext(uint8_t *data, size_t length);
+
     ssize_t length() const;
+
+    /* CRC-32 (see crc32.h) of the data moved by the last read or write call */
+    uint32_t crc() const;
+
+    /*
+     * Compare length bytes at offset against data, one file access chunk
+     * at a time. Returns 0 if everything matches and -EBADMSG otherwise,
+     * the differing chunks are appended to mismatches.
+     */
+    int verify(uint32_t offset, const uint8_t *data, size_t length, std::vector<FileRange> *mismatches = nullptr);
 private:
+    struct State {
+        std::atomic<size_t> refCount;
+        /* Position of the device's file access offset, if known */
+        std::optional<uint32_t> deviceOffset;
+        uint32_t cursor;
+        uint32_t crc;
+    };
+
     File(AlviumGenCP &gencp, FileSelector selector, FileOpenMode openMode);
 
+    uint32_t readChunkSize() const;
+    int seekDevice(uint32_t offset);
+    int seekDeviceVerified(uint32_t offset);
+    ssize_t preadChunks(uint32_t offset, uint8_t *data, size_t length, uint32_t &crc);
+    int readChunk(uint32_t offset, uint8_t *data, uint32_t length);
+    int writeChunk(uint32_t offset, const uint8_t *data, uint32_t length);
+    int writeChunkRetried(uint32_t offset, const uint8_t *data, uint32_t length);
+
     const FileSelector m_selector;
     const FileOpenMode m_openMode;
     AlviumGenCP &m_gencp;
-    size_t *m_refCount;
+    State *m_state;
 };
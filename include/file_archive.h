@@ -0,0 +1,97 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <file_access.h>
+#include <file_content.h>
+
+/*
+ * Archive of named entries inside one file. The index at the start of the
+ * file holds name, position and CRC of every entry, so a single entry is
+ * fetched by reading the index and the entry's byte range only. Every
+ * entry owns a slot of ArchiveAlignment granularity, an entry that still
+ * fits its slot is updated in place without touching the others.
+ */
+static constexpr uint32_t ArchiveMagic = 0x41555641; /* "AVUA" */
+static constexpr uint16_t ArchiveVersion = 1;
+static constexpr size_t ArchiveNameLength = 24;
+static constexpr uint32_t ArchiveAlignment = 64;
+static constexpr uint16_t ArchiveDefaultSlots = 8;
+
+struct ArchiveHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t slotCount;         /* index entries, used or not */
+    uint32_t dataLength;        /* bytes following the index */
+    uint32_t indexCrc;          /* over header and all index entries with this field zeroed */
+} __attribute__((packed));
+
+struct ArchiveEntry {
+    char name[ArchiveNameLength];   /* NUL terminated, empty for an unused slot */
+    uint32_t offset;                /* from the start of the file */
+    uint32_t length;
+    uint32_t capacity;              /* length of the slot reserved for the entry */
+    uint32_t crc;                   /* crc32() of the entry data */
+} __attribute__((packed));
+
+struct ArchiveIndex {
+    ArchiveHeader header;
+    std::vector<ArchiveEntry> entries;  /* all slots, see header.slotCount */
+
+    /* Returns nullptr if there is no entry called name */
+    const ArchiveEntry *find(const std::string &name) const;
+    std::vector<std::string> names() const;
+    size_t length() const;
+};
+
+struct ArchiveItem {
+    std::string name;
+    const uint8_t *data;
+    size_t length;
+    /* Slot size to reserve for later in-place growth, at least length */
+    size_t capacity = 0;
+};
+
+/* Returns std::nullopt if the file does not start with a valid index */
+std::optional<ArchiveIndex> readArchiveIndex(File &file);
+
+/* Stream one entry to sink, returns -EBADMSG if it does not match its CRC */
+ssize_t readArchiveEntry(File &file, const ArchiveEntry &entry, const FileSink &sink);
+/* Read the index and the entry called name, -ENOENT if there is none */
+ssize_t readArchiveEntry(File &file, const std::string &name, std::vector<uint8_t> &data);
+
+/*
+ * Replace the file with an archive of items, slotCount limits the number
+ * of entries. Returns the length of the archive.
+ */
+ssize_t writeArchive(AlviumGenCP &gencp, FileSelector selector, const std::vector<ArchiveItem> &items,
+                     uint16_t slotCount = ArchiveDefaultSlots);
+
+/*
+ * Store item as the entry of the same name, adding it if there is none.
+ * The entry is rewritten in place if it fits its slot, is the last one or
+ * is new and a slot is free, the index is written last. Otherwise the
+ * archive is written again. An empty file is turned into an archive,
+ * other files fail with -EINVAL.
+ */
+int updateArchiveEntry(AlviumGenCP &gencp, FileSelector selector, const ArchiveItem &item, UploadResult &result);
@@ -0,0 +1,90 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies Gmbh
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <file_access.h>
+
+/* Runs a callback, e.g. by posting it to the event loop of the caller */
+using Executor = std::function<void(std::function<void()> task)>;
+
+struct AsyncTransferOptions {
+    std::function<void(const TransferProgress &progress)> onProgress;
+    std::function<void(ssize_t result)> onComplete;
+    /* Where onProgress and onComplete run, on the transfer thread if empty */
+    Executor executor;
+};
+
+/*
+ * Result of readAsync() or writeAsync(). The transfer runs on its own
+ * thread and uses the AlviumGenCP session of the File exclusively until
+ * it completes. Destroying the handle cancels the transfer and waits
+ * for it.
+ */
+class TransferHandle {
+public:
+    TransferHandle(TransferHandle &&other) = default;
+    TransferHandle &operator=(TransferHandle &&other);
+    ~TransferHandle();
+
+    /* Stop at the next chunk boundary, the result is -ECANCELED then */
+    void cancel();
+
+    bool ready() const;
+    /* Block until the transfer completed and return its result */
+    ssize_t wait();
+    bool waitFor(std::chrono::nanoseconds timeout);
+
+    /* Most recent progress, also available without a callback */
+    TransferProgress progress() const;
+private:
+    struct State {
+        mutable std::mutex mutex;
+        std::condition_variable completed;
+        std::atomic<bool> cancelled{false};
+        bool done{false};
+        ssize_t result{0};
+        TransferProgress progress{};
+    };
+
+    using Transfer = std::function<ssize_t(const TransferControl &control)>;
+
+    TransferHandle(Transfer transfer, AsyncTransferOptions options);
+
+    void join();
+
+    std::shared_ptr<State> m_state;
+    std::thread m_thread;
+
+    friend TransferHandle readAsync(File file, FileSink sink, AsyncTransferOptions options);
+    friend TransferHandle writeAsync(File file, const uint8_t *data, size_t length, AsyncTransferOptions options);
+};
+
+/* File::read(sink) on a separate thread */
+TransferHandle readAsync(File file, FileSink sink, AsyncTransferOptions options = {});
+
+/* File::write() on a separate thread, data has to stay valid until the transfer completed */
+TransferHandle writeAsync(File file, const uint8_t *data, size_t length, AsyncTransferOptions options = {});
@@ -0,0 +1,42 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <file_access.h>
+
+/*
+ * Opt-in host side cache of file contents, kept next to the mailbox
+ * layout cache (see ALVIUM_CACHE_DIR) and keyed by the camera serial
+ * number. An entry is used if the file on the camera still has the same
+ * length and starts with the same content, compressed or archive header,
+ * whose CRCs fingerprint the data. Files without such a header are not
+ * cached. Enabled by setFileCacheEnabled or ALVIUM_FILE_CACHE=1.
+ */
+void setFileCacheEnabled(bool enabled);
+bool fileCacheEnabled();
+
+/*
+ * Same output as readContent, answered from the cache if it is valid.
+ * Otherwise the file is read and the cache updated. cached tells whether
+ * the camera data was skipped.
+ */
+ssize_t readContentCached(AlviumGenCP &gencp, FileSelector selector, const FileSink &sink, bool *cached = nullptr);
+
+/* Drop the cache entry, done by File when a file is opened for writing or removed */
+void invalidateFileCache(AlviumGenCP &gencp, FileSelector selector);
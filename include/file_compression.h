@@ -0,0 +1,83 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include <file_access.h>
+
+/*
+ * Compressed container for file data: a header followed by independently
+ * compressed blocks of CompressedBlockSize raw bytes. Every block starts
+ * with its stored size as 32 bit little endian value, bit 31 set means the
+ * block is stored uncompressed because compression did not pay off.
+ * The size limit of the device applies to the compressed size.
+ */
+static constexpr uint32_t CompressedMagic = 0x5A555641; /* "AVUZ" */
+static constexpr uint16_t CompressedVersion = 1;
+static constexpr uint32_t CompressedBlockSize = 0x8000;
+static constexpr uint32_t CompressedBlockStored = 1U << 31;
+
+enum class CompressionCodec : uint8_t {
+    Lz = 1,     /* built-in LZ77 codec, see lz_codec.h */
+};
+
+struct CompressedHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t codec;
+    uint8_t reserved;
+    uint32_t blockSize;
+    uint32_t rawLength;
+    uint32_t rawCrc;        /* crc32() of the uncompressed data */
+    uint32_t headerCrc;     /* over the header with this field zeroed */
+} __attribute__((packed));
+
+/* Returns std::nullopt if the file does not start with a valid header */
+std::optional<CompressedHeader> readCompressedHeader(File &file);
+
+/* Header and blocks of compressed data, every block starting with its size field */
+struct CompressedData {
+    CompressedHeader header;
+    std::vector<std::vector<uint8_t>> blocks;
+
+    /* Length of the file writeCompressed creates */
+    size_t storedLength() const;
+};
+
+/*
+ * Compress data in memory, the blocks in parallel. Done before the device
+ * is touched, so the stored length can be checked against its size limit.
+ * std::nullopt if data is too long for the header.
+ */
+std::optional<CompressedData> compressData(const uint8_t *data, size_t length);
+
+/*
+ * Write compressed data into an empty file opened for writing. Progress
+ * is reported in uncompressed bytes. Returns the number of bytes stored.
+ */
+ssize_t writeCompressed(File &file, const CompressedData &compressed, const TransferControl &control = {});
+
+/*
+ * Stream the uncompressed data to sink, every block is passed on as soon
+ * as it arrived. Returns the uncompressed length, or -EBADMSG if the data
+ * is corrupt or does not match the CRC in the header.
+ */
+ssize_t readCompressed(File &file, const FileSink &sink, const TransferControl &control = {});
@@ -0,0 +1,94 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include <file_access.h>
+
+/*
+ * Optional header stored in front of the payload of a file. It carries a
+ * CRC of the whole payload and of every ContentChunkSize bytes of it, so
+ * a writer can tell whether the camera already holds a payload, and which
+ * chunks differ, by reading only the header.
+ */
+static constexpr uint32_t ContentMagic = 0x44555641; /* "AVUD" */
+static constexpr uint16_t ContentVersion = 1;
+static constexpr uint32_t ContentChunkSize = 0x400;
+
+struct ContentHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerLength;      /* including the chunk CRC table */
+    uint32_t flags;
+    uint32_t payloadLength;
+    uint32_t payloadCrc;
+    uint32_t chunkSize;
+    uint32_t chunkCount;
+    uint32_t headerCrc;         /* over header and table with this field zeroed */
+} __attribute__((packed));
+
+struct ContentInfo {
+    ContentHeader header;
+    std::vector<uint32_t> chunkCrcs;
+};
+
+/* Header plus chunk table describing payload, ready to be stored */
+std::vector<uint8_t> buildContentHeader(const uint8_t *payload, size_t length, uint32_t flags = 0);
+
+/* Returns std::nullopt if the file does not start with a valid header */
+std::optional<ContentInfo> readContentHeader(File &file);
+
+/*
+ * Read the payload of a file, skipping the header if there is one. The
+ * payload is checked against the CRC in the header while it is streamed,
+ * -EBADMSG is returned after the last chunk if it does not match.
+ * Compressed files (see file_compression.h) are decompressed.
+ */
+ssize_t readContent(File &file, const FileSink &sink);
+
+enum class UploadAction {
+    Unchanged,  /* camera already held the payload */
+    Patched,    /* only differing chunks and the header were written */
+    Written,    /* file was deleted and written completely */
+};
+
+struct UploadResult {
+    UploadAction action;
+    size_t bytesWritten;
+    size_t bytesRepaired;   /* rewritten after verification */
+};
+
+/*
+ * Store payload with a content header. Skips the upload if the camera
+ * already holds the same payload and patches differing chunks in place
+ * if the layout is unchanged and the device supports offset writes.
+ * With verify, written data is read back and repaired as in verifyUpload.
+ */
+int uploadContent(AlviumGenCP &gencp, FileSelector selector, const uint8_t *payload, size_t length,
+                  UploadResult &result, bool verify = false);
+
+/*
+ * Read back length bytes at offset and rewrite only the chunks that differ
+ * from data, for a bounded number of rounds. Returns 0 once the file
+ * matches and -EBADMSG if it still differs.
+ */
+int verifyUpload(AlviumGenCP &gencp, FileSelector selector, uint32_t offset, const uint8_t *data, size_t length,
+                 size_t &bytesRepaired);
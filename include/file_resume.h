@@ -0,0 +1,56 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <filesystem>
+
+#include <file_access.h>
+
+/*
+ * Transfers that survive failures and restarts. Progress is recorded
+ * every ResumeChunkSize bytes in a journal next to the host cache (see
+ * ALVIUM_CACHE_DIR), keyed by the camera serial number, together with
+ * the CRC of the data confirmed so far. A chunk that fails is retried
+ * with growing delays before the transfer gives up.
+ */
+static constexpr uint32_t ResumeChunkSize = 0x1000;
+
+/*
+ * Replace the file with data. If an earlier upload of the same data was
+ * interrupted and the camera file still holds the confirmed bytes, the
+ * upload continues after them. resumed tells whether it did.
+ */
+ssize_t uploadResumable(AlviumGenCP &gencp, FileSelector selector, const uint8_t *data, size_t length,
+                        const TransferControl &control = {}, bool *resumed = nullptr);
+
+/*
+ * Download length bytes at offset into output. An interrupted download
+ * to the same output continues if the camera file has the same length and
+ * the range starts with the same 32 bytes, and output still matches the
+ * CRC in the journal. crc is set to crc32() of the whole range.
+ *
+ * The camera side is only recognized by its length and first bytes. A
+ * content file is rewritten as a whole, its header changes with the data,
+ * but a plain file changed in the middle without changing its length or
+ * start is not detected, the result then mixes old and new data. Check
+ * crc against a known value where that matters.
+ */
+ssize_t downloadResumable(AlviumGenCP &gencp, FileSelector selector, uint32_t offset, size_t length,
+                          const std::filesystem::path &output, uint32_t &crc,
+                          const TransferControl &control = {}, bool *resumed = nullptr);
@@ -0,0 +1,49 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <string>
+
+#include <file_access.h>
+#include <file_content.h>
+
+enum class UploadMode : uint32_t {
+    Plain,          /* replace the file with the data */
+    Content,        /* with a content header, see uploadContent */
+    Compressed,     /* see writeCompressed */
+    ArchiveEntry,   /* see updateArchiveEntry */
+};
+
+struct UploadOptions {
+    UploadMode mode = UploadMode::Plain;
+    /* Read the data back and repair it, compressed data is decompressed and compared */
+    bool verify = false;
+    std::string entry;      /* name for UploadMode::ArchiveEntry */
+    /* Plain uploads only, continue an interrupted upload, see uploadResumable */
+    bool resume = false;
+};
+
+/*
+ * Store data on the camera the way mode describes. Progress and cancel
+ * apply to plain and compressed uploads. Returns the number of bytes
+ * stored, which differs from length for compressed data, or 0 if the
+ * camera already held the data.
+ */
+ssize_t uploadFile(AlviumGenCP &gencp, FileSelector selector, const uint8_t *data, size_t length,
+                   const UploadOptions &options, UploadResult &result, const TransferControl &control = {});
@@ -21,33 +21,164 @@
 #include <memory>
 #include <optional>
 #include <array>
+#include <chrono>
+#include <vector>
 
 #include <sys/types.h>
 
+#include <gencp_scheduler.h>
+#include <gencp_stats.h>
+#include <gencp_trace.h>
+#include <gencp_transport.h>
+#include <gencp_wait.h>
+
+struct RegisterRead {
+    uint64_t addr;
+    uint8_t *buffer;
+    size_t length;
+};
+
+struct RegisterWrite {
+    uint64_t addr;
+    const uint8_t *buffer;
+    size_t length;
+};
+
 class AlviumGenCP {
 public:
     static std::optional<AlviumGenCP> open(int subdev);
+    static std::optional<AlviumGenCP> open(std::unique_ptr<GenCPTransport> transport, int subdev = -1);
 
     int writeRegister(uint64_t addr, const uint8_t *buffer, size_t length);
     int readRegister(uint64_t addr, uint8_t *buffer, size_t length); 
 
+    /*
+     * Batched variants of the above. Reads whose ranges are at most maxGap
+     * bytes apart are merged into one ReadMem as long as the result fits a
+     * single packet. Only pass a maxGap > 0 if the device maps the gap.
+     * Writes are only merged if they are contiguous.
+     */
+    int readRegisters(const RegisterRead *ops, size_t count, size_t maxGap = 0);
+    int writeRegisters(const RegisterWrite *ops, size_t count);
+
     size_t maxPacketSize() const;
     size_t maxReadPacketPayloadSize() const;
     size_t maxWritePacketPayloadSize() const;
+
+    void setWaitStrategy(std::unique_ptr<GenCPWaitStrategy> strategy);
+
+    /* Accumulated time spent polling mailbox handshake bytes */
+    std::chrono::nanoseconds waitTime() const;
+    void resetWaitTime();
+
+    /*
+     * Keep a host side shadow of the register range [addr, addr + length).
+     * Reads of exactly that range are answered from the shadow once it is
+     * valid and writes that would not change it are skipped. The caller
+     * is responsible for invalidating it when the device changes the value.
+     */
+    void addShadowRegion(uint64_t addr, size_t length);
+    void updateShadow(uint64_t addr, const uint8_t *buffer, size_t length);
+    void invalidateShadow(uint64_t addr, size_t length);
+    void invalidateShadow();
+
+    /*
+     * Number of buffer allocations done by this session. Packet buffers are
+     * allocated once on open, so this stays constant during transfers.
+     */
+    size_t allocationCount() const;
+
+    /*
+     * Verify the CRC of every received ack, enabled by default. A corrupted
+     * ReadMem ack is requested again, other commands fail with -EBADMSG.
+     */
+    void setAckCrcCheck(bool enabled);
+
+    /* Snapshot of the counters collected since open or the last reset */
+    GenCPStats stats() const;
+    void resetStats();
+    /* Used by File, operation is a FileOperation */
+    void recordFileOperation(unsigned operation, std::chrono::nanoseconds latency);
+
+    /* Record packets, handshakes and raw transfers into recorder, nullptr stops it */
+    void setTraceRecorder(TraceRecorder *recorder);
+
+    /*
+     * The session may be shared between threads, every call above holds
+     * it for its duration with control priority. Hold it across calls
+     * that belong together, e.g. the requests of one file access chunk,
+     * so bulk transfers give way to control requests between chunks.
+     */
+    SessionLock lock(RequestPriority priority = RequestPriority::Control);
 private:
-    AlviumGenCP(int transferFd, int subdev, std::array<uint16_t, 3> m_addr);
+    struct ShadowRegion {
+        uint64_t addr;
+        std::vector<uint8_t> data;
+        bool valid;
+    };
+
+    AlviumGenCP(std::unique_ptr<GenCPTransport> transport, int subdev, std::array<uint16_t, 3> m_addr);
 
     int writePaket(const void *paket, size_t length);
-    int readPaket(void *paket, size_t length);
+    int writePaket(const struct iovec *iov, int iovCount);
+    int readPaket(void *paket, size_t length,
+                  std::chrono::nanoseconds hint = std::chrono::nanoseconds::zero());
+    int readPaket(const struct iovec *iov, int iovCount,
+                  std::chrono::nanoseconds hint = std::chrono::nanoseconds::zero());
+
+    int waitHandshake(uint16_t addr, uint8_t expected, HandshakeStage stage,
+                      std::chrono::nanoseconds hint = std::chrono::nanoseconds::zero());
+
+    int writeMem(uint64_t addr, const uint8_t *buffer, size_t length);
+    int readMem(uint64_t addr, uint8_t *buffer, size_t length);
+    int readMemChunk(uint64_t addr, uint8_t *buffer, size_t length);
+
+    bool checkAckCRC(const struct iovec *iov, int iovCount) const;
+
+    void notePendingAck(std::chrono::steady_clock::time_point &since);
+    void recordPendingAckWait(std::chrono::steady_clock::time_point since);
+
+    ShadowRegion *findShadowRegion(uint64_t addr, size_t length);
+
+    template<typename T>
+    void reserve(std::vector<T> &vector, size_t size);
 
     int writeRaw(uint16_t addr, const uint8_t *buffer, size_t length) const;
     int readRaw(uint16_t addr, uint8_t *buffer, size_t length) const;
+    int writeRawv(uint16_t addr, const struct iovec *iov, int iovCount) const;
+    int readRawv(uint16_t addr, const struct iovec *iov, int iovCount) const;
 
-    const int m_transferFd;
+    /* Only reads the clock while a trace recorder is set */
+    std::chrono::steady_clock::time_point traceStart() const;
+    void trace(TraceEventType type, std::chrono::steady_clock::time_point start,
+               uint16_t addr, size_t length, int32_t arg = 0) const;
+
+    std::unique_ptr<GenCPTransport> m_transport;
     const int m_subdev;
     const std::array<uint16_t, 3> m_addr;
 
     uint16_t m_requestId{1};
+    bool m_ackCrcCheck{true};
+
+    std::unique_ptr<GenCPWaitStrategy> m_waitStrategy;
+    /* Behind a pointer so the session stays movable */
+    std::unique_ptr<GenCPScheduler> m_scheduler;
+    std::chrono::nanoseconds m_waitTime{};
+    uint64_t m_handshakePolls{0};
+
+    GenCPStats m_stats;
+    TraceRecorder *m_trace{nullptr};
+
+    size_t m_maxPacketSize;
+    size_t m_allocationCount{0};
+
+    /* uint64_t storage keeps the packed packet structs naturally aligned */
+    std::unique_ptr<uint64_t[]> m_txPaket;
+    std::unique_ptr<uint64_t[]> m_rxPaket;
+    std::vector<ShadowRegion> m_shadow;
+
+    std::vector<uint8_t> m_batchBuffer;
+    std::vector<size_t> m_batchOrder;
 };
 
 
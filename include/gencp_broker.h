@@ -0,0 +1,76 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+
+#include <gencp.h>
+
+/*
+ * Serves register and file operations of local clients over a Unix
+ * socket, see broker_client.h. Every camera gets one AlviumGenCP session
+ * that is kept open, and one worker thread, so requests of different
+ * clients to the same camera are serialized. Register reads queued at
+ * the same time are sent as one batch. Requests for a camera that can not
+ * be opened fail with -ENODEV and leave nothing behind.
+ */
+class Broker {
+public:
+    using SessionFactory = std::function<std::optional<AlviumGenCP>(int subdev)>;
+
+    explicit Broker(std::filesystem::path socketPath);
+    ~Broker();
+
+    /* Defaults to AlviumGenCP::open */
+    void setSessionFactory(SessionFactory factory);
+
+    /* Bind the socket, fails with -EADDRINUSE if another broker is running */
+    int listen();
+    /* Serve clients until stop is called */
+    int run();
+    void stop();
+private:
+    class CameraWorker;
+
+    void serveClient(int socket);
+    /* nullptr if the camera can not be opened */
+    CameraWorker *worker(int subdev);
+
+    const std::filesystem::path m_socketPath;
+    SessionFactory m_sessionFactory;
+    int m_socket{-1};
+
+    bool m_bound{false};
+
+    std::mutex m_openMutex;
+
+    std::mutex m_mutex;
+    bool m_stopped{false};
+    std::map<int, std::unique_ptr<CameraWorker>> m_workers;
+    std::set<int> m_clientSockets;
+    /* Client threads are detached, the destructor waits for them here */
+    std::condition_variable m_clientsDone;
+};
@@ -0,0 +1,73 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <gencp_stats.h>
+
+enum class RequestPriority : uint8_t {
+    Control,    /* short register accesses, e.g. exposure changes */
+    Bulk,       /* one chunk of a file transfer */
+};
+
+/*
+ * Grants one thread at a time access to an AlviumGenCP session. When the
+ * session is released, waiting control requests go before waiting bulk
+ * requests, so a control request waits for at most one request or chunk
+ * that is already running. The owning thread may acquire it again.
+ */
+class GenCPScheduler {
+public:
+    /* Returns false if the calling thread already owned the session */
+    bool acquire(RequestPriority priority);
+    void release();
+
+    /* Time control requests spent waiting, in nanoseconds */
+    Histogram controlWait() const;
+    void resetControlWait();
+private:
+    mutable std::mutex m_mutex;
+    std::condition_variable m_released;
+    std::thread::id m_owner;
+    unsigned m_depth{0};
+    unsigned m_controlWaiting{0};
+    Histogram m_controlWait;
+};
+
+/* Holds a GenCPScheduler for its lifetime, see AlviumGenCP::lock */
+class SessionLock {
+public:
+    SessionLock(GenCPScheduler &scheduler, RequestPriority priority) : m_scheduler{scheduler}
+    {
+        m_scheduler.acquire(priority);
+    }
+
+    SessionLock(const SessionLock &other) = delete;
+
+    ~SessionLock()
+    {
+        m_scheduler.release();
+    }
+private:
+    GenCPScheduler &m_scheduler;
+};
@@ -0,0 +1,121 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <gencp_transport.h>
+
+/*
+ * In-process emulation of the Alvium mailbox for running AlviumGenCP and
+ * File without a camera. Emulates the bootstrap pointer at 0x10, the
+ * request/ack handshake, the file access register block and a generic
+ * register space for everything else.
+ */
+class SimulatedTransport : public GenCPTransport {
+public:
+    struct Config {
+        /* Fixed cost of every raw read or write */
+        std::chrono::nanoseconds transactionLatency{};
+        /* Additional cost per transferred byte, e.g. ~90us at 100kHz I2C */
+        std::chrono::nanoseconds byteLatency{};
+        /* Device turnaround between accepting a request and posting its ack */
+        std::chrono::nanoseconds processingTime{};
+        size_t maxTransferSize{1024};
+        uint32_t maxFileSize{0x10000};
+    };
+
+    SimulatedTransport();
+    explicit SimulatedTransport(const Config &config);
+
+    int readv(uint16_t addr, const struct iovec *iov, int iovCount) override;
+    int writev(uint16_t addr, const struct iovec *iov, int iovCount) override;
+
+    size_t maxTransferSize() const override;
+
+    /*
+     * Answer the next count requests with a pending ack announcing
+     * timeoutMs first. The final ack follows after delay.
+     */
+    void injectPendingAcks(unsigned count, uint16_t timeoutMs, std::chrono::nanoseconds delay);
+
+    /* Flip a payload bit in the next count acks after their CRC was computed */
+    void injectAckCorruption(unsigned count);
+
+    void setRegister(uint64_t addr, const uint8_t *data, size_t length);
+    void getRegister(uint64_t addr, uint8_t *data, size_t length) const;
+
+    std::vector<uint8_t> &file(uint32_t selector);
+
+    size_t transactionCount() const { return m_transactionCount; }
+    size_t bytesTransferred() const { return m_bytesTransferred; }
+    size_t requestCount() const { return m_requestCount; }
+
+private:
+    struct Response {
+        std::vector<uint8_t> paket;
+        std::chrono::nanoseconds delay;
+    };
+
+    void simulateLatency(size_t length) const;
+    void update();
+
+    int readMailbox(uint16_t addr, uint8_t *buffer, size_t length);
+    int writeMailbox(uint16_t addr, const uint8_t *buffer, size_t length);
+
+    void processRequest();
+    void queueAck(uint16_t status, uint16_t commandId, uint16_t requestId,
+                  const uint8_t *scd, size_t scdLength, std::chrono::nanoseconds delay);
+
+    uint16_t readMemory(uint64_t addr, uint8_t *buffer, size_t length);
+    uint16_t writeMemory(uint64_t addr, const uint8_t *buffer, size_t length);
+    uint16_t executeFileOperation(uint64_t value);
+
+    const Config m_config;
+
+    std::vector<uint8_t> m_mailbox;
+
+    std::deque<Response> m_responses;
+    std::chrono::steady_clock::time_point m_responseReadyAt{};
+    bool m_responsePosted{false};
+
+    unsigned m_pendingAcks{0};
+    uint16_t m_pendingTimeout{0};
+    std::chrono::nanoseconds m_pendingDelay{};
+
+    unsigned m_corruptAcks{0};
+
+    std::unordered_map<uint64_t, uint8_t> m_registers;
+
+    std::map<uint32_t, std::vector<uint8_t>> m_files;
+    std::vector<uint8_t> m_fileBuffer;
+    bool m_fileOpen{false};
+    uint8_t m_fileOpenMode{0};
+    uint32_t m_fileSelector{0};
+    uint32_t m_fileOffset{0};
+    uint32_t m_fileAccessLength{0};
+
+    size_t m_transactionCount{0};
+    size_t m_bytesTransferred{0};
+    size_t m_requestCount{0};
+};
@@ -0,0 +1,88 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies Gmbh
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <array>
+#include <filesystem>
+#include <string>
+
+#include <cstddef>
+#include <cstdint>
+
+class TraceRecorder;
+
+/* Histogram with power of two buckets, bucket i counts values in (2^(i-1), 2^i] */
+class Histogram {
+public:
+    static constexpr unsigned BucketCount = 65;
+
+    void record(uint64_t value);
+
+    uint64_t count() const;
+    uint64_t sum() const;
+    /* Number of values up to 2^exponent */
+    uint64_t countUpTo(unsigned exponent) const;
+private:
+    std::array<uint64_t, BucketCount> m_buckets{};
+    uint64_t m_count{};
+    uint64_t m_sum{};
+};
+
+/* Operations of the file access feature, see FileOperation */
+static constexpr size_t FileOperationCount = 5;
+
+/* Counters of one AlviumGenCP session, latencies are in nanoseconds */
+struct GenCPStats {
+    uint64_t packetsSent{};
+    uint64_t packetsReceived{};
+    uint64_t bytesSent{};
+    uint64_t bytesReceived{};
+    uint64_t pendingAcks{};
+    uint64_t ackCrcErrors{};
+    uint64_t shadowHits{};
+
+    Histogram handshakePolls;       /* mailbox polls per packet */
+    Histogram pendingAckWait;       /* first pending ack until the final ack */
+    Histogram controlWait;          /* control requests waiting for another thread's request or chunk */
+    Histogram readRegisterLatency;
+    Histogram writeRegisterLatency;
+    Histogram readRegisterBytes;
+    Histogram writeRegisterBytes;
+    std::array<Histogram, FileOperationCount> fileOperationLatency;
+};
+
+/* Human readable summary */
+std::string formatStats(const GenCPStats &stats);
+
+/*
+ * Prometheus text exposition format, e.g. for the textfile collector of
+ * the node exporter. labels is added to every sample, e.g. subdev="6".
+ */
+std::string formatPrometheus(const GenCPStats &stats, const std::string &labels = {});
+
+/* Replace path with formatPrometheus(), atomically so a collector never reads a partial file */
+int writePrometheusFile(const std::filesystem::path &path, const GenCPStats &stats, const std::string &labels = {});
+
+/*
+ * What the tools do after a transfer: print formatStats() to stderr if
+ * printStats is set, write prometheusFile and the trace to traceFile
+ * unless they are empty. The Prometheus samples are labeled with subdev.
+ */
+int reportStats(const GenCPStats &stats, int subdev, bool printStats, const std::filesystem::path &prometheusFile,
+                const TraceRecorder *trace = nullptr, const std::filesystem::path &traceFile = {});
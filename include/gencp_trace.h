@@ -0,0 +1,71 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies Gmbh
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <vector>
+
+#include <cstdint>
+
+enum class TraceEventType : uint8_t {
+    WritePaket,
+    ReadPaket,
+    Handshake,      /* arg: HandshakeStage */
+    PendingAck,     /* arg: announced timeout in ms */
+    RawRead,
+    RawWrite,
+};
+
+struct TraceEvent {
+    int64_t start;          /* steady clock, ns */
+    uint32_t duration;      /* ns */
+    uint16_t addr;
+    uint16_t length;
+    int32_t arg;
+    int16_t subdev;
+    TraceEventType type;
+};
+
+/*
+ * Fixed size ring buffer of trace events. Sessions record into it while
+ * a pointer to it is set with AlviumGenCP::setTraceRecorder(). Several
+ * sessions may share a recorder, the oldest events are overwritten once
+ * it is full. Reading events while sessions record is not supported.
+ */
+class TraceRecorder {
+public:
+    explicit TraceRecorder(size_t capacity = 1 << 16);
+
+    void record(TraceEventType type, int subdev, std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point end, uint16_t addr, size_t length, int32_t arg = 0);
+
+    /* Recorded events, oldest first */
+    std::vector<TraceEvent> events() const;
+    /* Events that were overwritten */
+    size_t dropped() const;
+    void clear();
+
+    /* Chrome trace event JSON, opens in Perfetto or chrome://tracing. One track per subdev */
+    int writeChromeTrace(const std::filesystem::path &path) const;
+private:
+    std::vector<TraceEvent> m_events;
+    std::atomic<size_t> m_next{0};
+};
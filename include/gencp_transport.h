@@ -0,0 +1,86 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include <cstdint>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/*
+ * Raw access to the Alvium mailbox address space. AlviumGenCP implements
+ * the GenCP handshake on top of this. Returns 0 on success and a negative
+ * errno on failure.
+ *
+ * readv() and writev() transfer one contiguous mailbox range scattered
+ * over or gathered from up to MaxIovCount buffers.
+ */
+class GenCPTransport {
+public:
+    static constexpr int MaxIovCount = 4;
+
+    virtual ~GenCPTransport() = default;
+
+    virtual int readv(uint16_t addr, const struct iovec *iov, int iovCount) = 0;
+    virtual int writev(uint16_t addr, const struct iovec *iov, int iovCount) = 0;
+
+    int read(uint16_t addr, uint8_t *buffer, size_t length)
+    {
+        struct iovec const iov{buffer, length};
+        return readv(addr, &iov, 1);
+    }
+
+    int write(uint16_t addr, const uint8_t *buffer, size_t length)
+    {
+        struct iovec const iov{const_cast<uint8_t*>(buffer), length};
+        return writev(addr, &iov, 1);
+    }
+
+    /* Largest payload of a single read or write */
+    virtual size_t maxTransferSize() const = 0;
+};
+
+/*
+ * Transport through the fw_transfer sysfs attribute of the Alvium driver.
+ * The transfer header and payload have to reach the driver in one write,
+ * but kernels before 5.11 split vectored I/O on sysfs attributes into one
+ * call per buffer. Scattered transfers therefore go through a staging
+ * buffer and a single pread or pwrite.
+ */
+class SysfsTransport : public GenCPTransport {
+public:
+    static std::unique_ptr<SysfsTransport> open(const std::filesystem::path &fwTransferPath);
+
+    ~SysfsTransport() override;
+
+    int readv(uint16_t addr, const struct iovec *iov, int iovCount) override;
+    int writev(uint16_t addr, const struct iovec *iov, int iovCount) override;
+
+    size_t maxTransferSize() const override;
+private:
+    SysfsTransport(int fd, size_t attributeSize);
+
+    const int m_fd;
+    /* Transfer header and payload */
+    std::vector<uint8_t> m_staging;
+};
@@ -0,0 +1,101 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+
+#include <cstdint>
+
+/* The mailbox handshake bytes AlviumGenCP polls on. */
+enum class HandshakeStage : uint8_t {
+    RequestIdle,        /* request handshake (0x18) back to 0 */
+    RequestAccepted,    /* device took the request (0x18 == 2) */
+    ResponseReady,      /* ack available (0x1C == 1) */
+    ResponseReleased,   /* ack release confirmed (0x1C == 2) */
+};
+
+static constexpr size_t HandshakeStageCount = 4;
+
+/*
+ * Decides how long to wait between two polls of a handshake byte.
+ *
+ * begin() is called once before polling starts, nextDelay() after every
+ * poll that did not yet see the expected value and complete() once the
+ * expected value was read. hint is the turnaround the device announced
+ * with a pending ack, or zero if nothing is known.
+ */
+class GenCPWaitStrategy {
+public:
+    using Duration = std::chrono::nanoseconds;
+
+    virtual ~GenCPWaitStrategy() = default;
+
+    virtual void begin(HandshakeStage stage, Duration hint) = 0;
+    virtual Duration nextDelay() = 0;
+    virtual void complete(HandshakeStage stage, Duration elapsed) = 0;
+};
+
+/* Sleeps a constant time between polls. A delay of zero busy polls. */
+class FixedWaitStrategy : public GenCPWaitStrategy {
+public:
+    explicit FixedWaitStrategy(Duration delay) : m_delay{delay} {}
+
+    void begin(HandshakeStage, Duration) override {}
+    Duration nextDelay() override { return m_delay; }
+    void complete(HandshakeStage, Duration) override {}
+
+private:
+    const Duration m_delay;
+};
+
+/*
+ * Polls back to back for a few rounds, then sleeps with exponentially
+ * growing delays. The first sleep is derived from a running average of
+ * the turnaround seen for the same handshake stage on this device.
+ */
+class AdaptiveWaitStrategy : public GenCPWaitStrategy {
+public:
+    struct Config {
+        unsigned spinPolls{4};
+        Duration minDelay{std::chrono::microseconds(50)};
+        Duration maxDelay{std::chrono::milliseconds(20)};
+        /* weight of a new sample is 1 / 2^learningShift */
+        unsigned learningShift{3};
+    };
+
+    AdaptiveWaitStrategy() = default;
+    explicit AdaptiveWaitStrategy(const Config &config) : m_config{config} {}
+
+    void begin(HandshakeStage stage, Duration hint) override;
+    Duration nextDelay() override;
+    void complete(HandshakeStage stage, Duration elapsed) override;
+
+    Duration estimate(HandshakeStage stage) const;
+
+private:
+    const Config m_config{};
+
+    std::array<Duration, HandshakeStageCount> m_estimate{};
+
+    HandshakeStage m_stage{HandshakeStage::RequestIdle};
+    Duration m_hint{};
+    Duration m_delay{};
+    unsigned m_polls{0};
+};
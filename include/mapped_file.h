@@ -0,0 +1,48 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <optional>
+
+#include <cstdint>
+
+#include <sys/types.h>
+
+/* A whole file mapped into memory, unmapped on destruction */
+class MappedFile {
+public:
+    /* Map an existing file read-only */
+    static std::optional<MappedFile> openRead(const std::filesystem::path &path);
+    /* Create or truncate path to length bytes, allocate them on disk and map it writable */
+    static std::optional<MappedFile> create(const std::filesystem::path &path, size_t length);
+
+    MappedFile(MappedFile &&other);
+    MappedFile(const MappedFile &other) = delete;
+
+    ~MappedFile();
+
+    uint8_t *data() const { return m_data; }
+    size_t size() const { return m_size; }
+private:
+    MappedFile(uint8_t *data, size_t size);
+
+    uint8_t *m_data;
+    size_t m_size;
+};
@@ -0,0 +1,89 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies Gmbh
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include <broker_client.h>
+#include <file_access.h>
+
+/* Outcome of the operation on one camera */
+struct CameraResult {
+    int subdev;
+    ssize_t result;         /* bytes transferred or a negative error */
+    std::chrono::nanoseconds duration;
+};
+
+/*
+ * Runs an operation on many cameras concurrently. Every camera gets its
+ * own AlviumGenCP session, or its own broker connection once a broker
+ * socket is set, at most maxWorkers of them are active at the same time.
+ * Results are returned in the order of the subdevs passed.
+ */
+class TransferEngine {
+public:
+    /* Called from the worker threads, but never concurrently */
+    using ProgressCallback = std::function<void(int subdev, size_t done, size_t total)>;
+    using SessionFactory = std::function<std::optional<AlviumGenCP>(int subdev)>;
+
+    /* Reports the progress of the camera an operation runs on */
+    using Progress = std::function<void(size_t done, size_t total)>;
+    using Operation = std::function<ssize_t(AlviumGenCP &gencp, int subdev, const Progress &progress)>;
+    using BrokerOperation = std::function<ssize_t(BrokerClient &broker, int subdev, const Progress &progress)>;
+
+    /* maxWorkers 0 uses one worker per hardware thread */
+    explicit TransferEngine(unsigned maxWorkers = 0);
+
+    void setProgressCallback(ProgressCallback callback);
+    /* Defaults to AlviumGenCP::open */
+    void setSessionFactory(SessionFactory factory);
+    /* Make upload and download go through the broker at socketPath, see gencp_broker.h */
+    void setBrokerSocket(std::filesystem::path socketPath);
+
+    std::vector<CameraResult> run(const std::vector<int> &subdevs, const Operation &operation);
+    /* Requires a broker socket */
+    std::vector<CameraResult> runBrokered(const std::vector<int> &subdevs, const BrokerOperation &operation);
+
+    /*
+     * Replace the file on every camera with the same data. With sync the
+     * data is stored with a content header, see uploadContent.
+     */
+    std::vector<CameraResult> upload(const std::vector<int> &subdevs, FileSelector selector,
+                                     const uint8_t *data, size_t length, bool sync = false);
+
+    /* Stream the file payload of every camera into the sink returned for its subdev */
+    std::vector<CameraResult> download(const std::vector<int> &subdevs, FileSelector selector,
+                                       const std::function<FileSink(int subdev)> &sinkFactory);
+private:
+    using CameraTask = std::function<ssize_t(int subdev, const Progress &progress)>;
+
+    void reportProgress(int subdev, size_t done, size_t total);
+    std::vector<CameraResult> runTasks(const std::vector<int> &subdevs, const CameraTask &task);
+
+    unsigned m_maxWorkers;
+    ProgressCallback m_progressCallback;
+    SessionFactory m_sessionFactory;
+    std::optional<std::filesystem::path> m_brokerSocket;
+    std::mutex m_progressMutex;
+};
@@ -0,0 +1,298 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <type_traits>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <broker_client.h>
+
+#include "broker_protocol.h"
+#include "transfer_monitor.h"
+
+static const char *const DefaultBrokerSocket = "/run/alvium_file_access/broker.sock";
+
+
+std::optional<std::filesystem::path> brokerSocketPath()
+{
+    auto const env = std::getenv("ALVIUM_BROKER_SOCKET");
+    std::filesystem::path const path{env ? env : DefaultBrokerSocket};
+
+    if (path.empty())
+        return std::nullopt;
+
+    return path;
+}
+
+std::optional<BrokerClient> BrokerClient::connect()
+{
+    auto const path = brokerSocketPath();
+    if (!path)
+        return std::nullopt;
+
+    return connect(*path);
+}
+
+std::optional<BrokerClient> BrokerClient::connect(const std::filesystem::path &socketPath)
+{
+    struct sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+
+    if (socketPath.native().size() >= sizeof(addr.sun_path))
+        return std::nullopt;
+
+    strcpy(addr.sun_path, socketPath.c_str());
+
+    UniqueFd socket{::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)};
+    if (!socket)
+        return std::nullopt;
+
+    if (::connect(socket.get(), reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0)
+        return std::nullopt;
+
+    return BrokerClient{socket.release()};
+}
+
+BrokerClient::BrokerClient(int socket) : m_socket{socket}
+{
+}
+
+BrokerClient::BrokerClient(BrokerClient &&other) : m_socket{other.m_socket}
+{
+    other.m_socket = -1;
+}
+
+BrokerClient::~BrokerClient()
+{
+    if (m_socket >= 0)
+        ::close(m_socket);
+}
+
+static BrokerRequest makeRequest(BrokerOp op, int subdev)
+{
+    BrokerRequest request{};
+    request.op = uint32_t(op);
+    request.subdev = subdev;
+
+    return request;
+}
+
+static int setEntry(BrokerRequest &request, const std::string &entry)
+{
+    if (entry.size() >= sizeof(request.entry))
+        return -EINVAL;
+
+    memcpy(request.entry, entry.data(), entry.size());
+
+    return 0;
+}
+
+/* One request and its response, the broker answers requests of a connection in order */
+static ssize_t transact(int socket, const BrokerRequest &request, const uint8_t *data, size_t length, int fd,
+                        BrokerResponse &response, std::vector<uint8_t> &responseData, UniqueFd &responseFd)
+{
+    int res = sendBrokerMessage(socket, &request, sizeof(request), data, length, fd);
+    if (res < 0)
+        return res;
+
+    auto const received = receiveBrokerMessage(socket, &response, sizeof(response), responseData, responseFd);
+    if (received <= 0)
+        return received < 0 ? received : -ECONNRESET;
+
+    return response.result;
+}
+
+int BrokerClient::readRegister(int subdev, uint64_t addr, uint8_t *buffer, size_t length)
+{
+    if (length > BrokerInlineLength)
+        return -EINVAL;
+
+    auto request = makeRequest(BrokerOp::ReadRegister, subdev);
+    request.addr = addr;
+    request.length = length;
+
+    BrokerResponse response{};
+    std::vector<uint8_t> data;
+    UniqueFd fd;
+
+    auto const res = transact(m_socket, request, nullptr, 0, -1, response, data, fd);
+    if (res < 0)
+        return res;
+
+    if (data.size() != length)
+        return -EBADMSG;
+
+    memcpy(buffer, data.data(), length);
+
+    return 0;
+}
+
+int BrokerClient::writeRegister(int subdev, uint64_t addr, const uint8_t *buffer, size_t length)
+{
+    if (length > BrokerInlineLength)
+        return -EINVAL;
+
+    auto request = makeRequest(BrokerOp::WriteRegister, subdev);
+    request.addr = addr;
+    request.length = length;
+
+    BrokerResponse response{};
+    std::vector<uint8_t> data;
+    UniqueFd fd;
+
+    return transact(m_socket, request, buffer, length, -1, response, data, fd);
+}
+
+ssize_t BrokerClient::readContent(int subdev, FileSelector selector, const FileSink &sink,
+                                  const BrokerReadOptions &options, bool *cached)
+{
+    auto request = makeRequest(BrokerOp::ReadContent, subdev);
+    request.selector = uint32_t(selector);
+    request.flags = options.useCache ? uint32_t(BrokerFlagCached) : 0;
+
+    int res = setEntry(request, options.entry);
+    if (res < 0)
+        return res;
+
+    BrokerResponse response{};
+    std::vector<uint8_t> data;
+    UniqueFd fd;
+
+    auto const length = transact(m_socket, request, nullptr, 0, -1, response, data, fd);
+    if (length < 0)
+        return length;
+
+    if (cached)
+        *cached = response.flags & BrokerFlagCached;
+
+    if (response.length == 0)
+        return 0;
+
+    auto const buffer = SharedBuffer::map(std::move(fd), response.length);
+    if (!buffer)
+        return -EBADMSG;
+
+    res = sink(buffer->data(), buffer->size());
+    if (res < 0)
+        return res;
+
+    return buffer->size();
+}
+
+ssize_t BrokerClient::upload(int subdev, FileSelector selector, const uint8_t *data, size_t length,
+                             const UploadOptions &options, UploadResult &result, const TransferControl &control)
+{
+    auto const reportProgress = control.progress || control.cancelled;
+
+    auto request = makeRequest(BrokerOp::Upload, subdev);
+    request.selector = uint32_t(selector);
+    request.flags = (options.verify ? uint32_t(BrokerFlagVerify) : 0)
+                  | (options.resume ? uint32_t(BrokerFlagResume) : 0)
+                  | (reportProgress ? uint32_t(BrokerFlagProgress) : 0);
+    request.mode = uint32_t(options.mode);
+    request.length = length;
+
+    if (length > UINT32_MAX)
+        return -EINVAL;
+
+    int res = setEntry(request, options.entry);
+    if (res < 0)
+        return res;
+
+    /* The only copy of the data on its way to the broker */
+    auto buffer = SharedBuffer::create(length);
+    if (!buffer)
+        return -ENOMEM;
+
+    if (length > 0)
+        memcpy(buffer->data(), data, length);
+
+    res = buffer->seal();
+    if (res < 0)
+        return res;
+
+    res = sendBrokerMessage(m_socket, &request, sizeof(request), nullptr, 0, buffer->fd());
+    if (res < 0)
+        return res;
+
+    TransferMonitor monitor{control, length};
+    BrokerResponse response{};
+    bool cancelSent = false;
+
+    /* Progress reports until the final response */
+    for (;;) {
+        std::vector<uint8_t> responseData;
+        UniqueFd fd;
+
+        auto const received = receiveBrokerMessage(m_socket, &response, sizeof(response), responseData, fd);
+        if (received <= 0)
+            return received < 0 ? received : -ECONNRESET;
+
+        if (!(response.flags & BrokerFlagProgress))
+            break;
+
+        if (monitor.update(response.result) < 0 && !cancelSent) {
+            auto const cancel = makeRequest(BrokerOp::Cancel, subdev);
+
+            res = sendBrokerMessage(m_socket, &cancel, sizeof(cancel), nullptr, 0);
+            if (res < 0)
+                return res;
+
+            cancelSent = true;
+        }
+    }
+
+    auto const stored = response.result;
+    if (stored < 0)
+        return stored;
+
+    result.action = UploadAction(response.action);
+    result.bytesWritten = response.bytesWritten;
+    result.bytesRepaired = response.bytesRepaired;
+
+    return stored;
+}
+
+int BrokerClient::stats(int subdev, GenCPStats &stats)
+{
+    static_assert(std::is_trivially_copyable<GenCPStats>::value, "stats are sent as raw bytes");
+
+    auto request = makeRequest(BrokerOp::Stats, subdev);
+
+    BrokerResponse response{};
+    std::vector<uint8_t> data;
+    UniqueFd fd;
+
+    auto const res = transact(m_socket, request, nullptr, 0, -1, response, data, fd);
+    if (res < 0)
+        return res;
+
+    auto const buffer = SharedBuffer::map(std::move(fd), response.length);
+    if (!buffer || buffer->size() != sizeof(stats))
+        return -EBADMSG;
+
+    memcpy(&stats, buffer->data(), sizeof(stats));
+
+    return 0;
+}
@@ -0,0 +1,249 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "broker_protocol.h"
+
+
+UniqueFd &UniqueFd::operator=(UniqueFd &&other)
+{
+    if (this != &other) {
+        if (m_fd >= 0)
+            ::close(m_fd);
+
+        m_fd = other.release();
+    }
+
+    return *this;
+}
+
+UniqueFd::~UniqueFd()
+{
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+int UniqueFd::release()
+{
+    auto const fd = m_fd;
+    m_fd = -1;
+
+    return fd;
+}
+
+std::optional<SharedBuffer> SharedBuffer::create(size_t length)
+{
+    UniqueFd fd{::memfd_create("alvium_broker", MFD_CLOEXEC | MFD_ALLOW_SEALING)};
+    if (!fd)
+        return std::nullopt;
+
+    if (::ftruncate(fd.get(), length) < 0)
+        return std::nullopt;
+
+    return mapFd(std::move(fd), length);
+}
+
+std::optional<SharedBuffer> SharedBuffer::map(UniqueFd fd, size_t length)
+{
+    if (length == 0)
+        return SharedBuffer{std::move(fd), nullptr, 0};
+
+    auto const seals = ::fcntl(fd.get(), F_GET_SEALS);
+    if (seals < 0 || !(seals & F_SEAL_SHRINK))
+        return std::nullopt;
+
+    /* The peer may have handed over a smaller file than announced */
+    struct stat stat{};
+    if (::fstat(fd.get(), &stat) < 0 || size_t(stat.st_size) < length)
+        return std::nullopt;
+
+    return mapFd(std::move(fd), length);
+}
+
+std::optional<SharedBuffer> SharedBuffer::mapFd(UniqueFd fd, size_t length)
+{
+    if (length == 0)
+        return SharedBuffer{std::move(fd), nullptr, 0};
+
+    auto const data = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (data == MAP_FAILED)
+        return std::nullopt;
+
+    return SharedBuffer{std::move(fd), static_cast<uint8_t*>(data), length};
+}
+
+SharedBuffer::SharedBuffer(UniqueFd fd, uint8_t *data, size_t size) : m_fd{std::move(fd)}, m_data{data}, m_size{size}
+{
+}
+
+SharedBuffer::SharedBuffer(SharedBuffer &&other) : m_fd{std::move(other.m_fd)}, m_data{other.m_data}, m_size{other.m_size}
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+
+SharedBuffer &SharedBuffer::operator=(SharedBuffer &&other)
+{
+    if (this != &other) {
+        if (m_data)
+            ::munmap(m_data, m_size);
+
+        m_fd = std::move(other.m_fd);
+        m_data = other.m_data;
+        m_size = other.m_size;
+
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+
+    return *this;
+}
+
+int SharedBuffer::resize(size_t length)
+{
+    if (::ftruncate(m_fd.get(), length) < 0)
+        return -errno;
+
+    void *data = nullptr;
+
+    if (length == 0)
+        ::munmap(m_data, m_size);
+    else if (m_data)
+        data = ::mremap(m_data, m_size, length, MREMAP_MAYMOVE);
+    else
+        data = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd.get(), 0);
+
+    if (data == MAP_FAILED)
+        return -errno;
+
+    m_data = static_cast<uint8_t*>(data);
+    m_size = length;
+
+    return 0;
+}
+
+int SharedBuffer::seal()
+{
+    if (::fcntl(m_fd.get(), F_ADD_SEALS, F_SEAL_SHRINK) < 0)
+        return -errno;
+
+    return 0;
+}
+
+SharedBuffer::~SharedBuffer()
+{
+    if (m_data)
+        ::munmap(m_data, m_size);
+}
+
+int sendBrokerMessage(int socket, const void *header, size_t headerLength,
+                      const uint8_t *data, size_t length, int fd)
+{
+    struct iovec iov[2] = {
+        {const_cast<void*>(header), headerLength},
+        {const_cast<uint8_t*>(data), length},
+    };
+
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control{};
+
+    struct msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = length > 0 ? 2 : 1;
+
+    if (fd >= 0) {
+        msg.msg_control = control.buffer;
+        msg.msg_controllen = sizeof(control.buffer);
+
+        auto const cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    ssize_t res;
+
+    do {
+        res = ::sendmsg(socket, &msg, MSG_NOSIGNAL);
+    } while (res < 0 && errno == EINTR);
+
+    if (res < 0)
+        return -errno;
+
+    return 0;
+}
+
+ssize_t receiveBrokerMessage(int socket, void *header, size_t headerLength,
+                             std::vector<uint8_t> &data, UniqueFd &fd)
+{
+    data.resize(BrokerInlineLength);
+
+    struct iovec iov[2] = {
+        {header, headerLength},
+        {data.data(), data.size()},
+    };
+
+    union {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control{};
+
+    struct msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+    ssize_t res;
+
+    do {
+        res = ::recvmsg(socket, &msg, MSG_CMSG_CLOEXEC);
+    } while (res < 0 && errno == EINTR);
+
+    if (res < 0)
+        return -errno;
+
+    for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            int received;
+            memcpy(&received, CMSG_DATA(cmsg), sizeof(int));
+            fd = UniqueFd{received};
+        }
+    }
+
+    if (res == 0)
+        return 0;
+
+    if (size_t(res) < headerLength || (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)))
+        return -EBADMSG;
+
+    data.resize(res - headerLength);
+
+    return res;
+}
@@ -0,0 +1,138 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include <cstdint>
+
+#include <sys/types.h>
+
+#include <file_archive.h>
+
+/*
+ * Messages between BrokerClient and Broker. Every request and response is
+ * one SOCK_SEQPACKET message, register data travels inline. Bulk data is
+ * placed in a memfd whose descriptor is passed along with the message,
+ * sealed against shrinking, see SharedBuffer.
+ * An upload requested with BrokerFlagProgress is answered by progress
+ * responses before the final one, with result holding the bytes done and
+ * length the total. The client may send BrokerOp::Cancel meanwhile, which
+ * gets no response of its own.
+ */
+static constexpr uint32_t BrokerInlineLength = 1024;
+
+enum class BrokerOp : uint32_t {
+    ReadRegister = 1,
+    WriteRegister = 2,
+    ReadContent = 3,
+    Upload = 4,
+    Stats = 5,
+    Cancel = 6,
+};
+
+enum BrokerFlags : uint32_t {
+    BrokerFlagCached = 1 << 0,  /* request: use the file cache, response: answered from it */
+    BrokerFlagVerify = 1 << 1,
+    BrokerFlagResume = 1 << 2,
+    BrokerFlagProgress = 1 << 3,    /* request: report progress, response: this is a progress report */
+};
+
+struct BrokerRequest {
+    uint32_t op;
+    int32_t subdev;
+    uint32_t selector;
+    uint32_t flags;
+    uint64_t addr;
+    uint32_t length;            /* of the register access or the shared buffer */
+    uint32_t mode;              /* UploadMode */
+    char entry[ArchiveNameLength];
+} __attribute__((packed));
+
+struct BrokerResponse {
+    int64_t result;
+    uint32_t length;            /* of the inline data or the shared buffer */
+    uint32_t flags;
+    uint32_t action;            /* UploadAction */
+    uint64_t bytesWritten;
+    uint64_t bytesRepaired;
+} __attribute__((packed));
+
+/* Owned descriptor, closed on destruction */
+class UniqueFd {
+public:
+    explicit UniqueFd(int fd = -1) : m_fd{fd} {}
+    UniqueFd(UniqueFd &&other) : m_fd{other.release()} {}
+    UniqueFd &operator=(UniqueFd &&other);
+    UniqueFd(const UniqueFd &other) = delete;
+
+    ~UniqueFd();
+
+    int get() const { return m_fd; }
+    int release();
+    explicit operator bool() const { return m_fd >= 0; }
+private:
+    int m_fd;
+};
+
+/*
+ * memfd mapping shared between client and broker. A memfd that the peer
+ * could still shrink would make accesses to the mapping fault with SIGBUS,
+ * so the sender seals it and map() rejects descriptors without the seal.
+ */
+class SharedBuffer {
+public:
+    static std::optional<SharedBuffer> create(size_t length);
+    static std::optional<SharedBuffer> map(UniqueFd fd, size_t length);
+
+    SharedBuffer(SharedBuffer &&other);
+    SharedBuffer &operator=(SharedBuffer &&other);
+    SharedBuffer(const SharedBuffer &other) = delete;
+
+    ~SharedBuffer();
+
+    uint8_t *data() const { return m_data; }
+    size_t size() const { return m_size; }
+    int fd() const { return m_fd.get(); }
+
+    /* Change the length of the memfd and the mapping, data() may move but keeps its contents */
+    int resize(size_t length);
+    /* Forbid shrinking the memfd from now on, done before handing it to the peer */
+    int seal();
+private:
+    SharedBuffer(UniqueFd fd, uint8_t *data, size_t size);
+
+    static std::optional<SharedBuffer> mapFd(UniqueFd fd, size_t length);
+
+    UniqueFd m_fd;
+    uint8_t *m_data;
+    size_t m_size;
+};
+
+/* Send header and inline data as one message, fd is passed along if >= 0 */
+int sendBrokerMessage(int socket, const void *header, size_t headerLength,
+                      const uint8_t *data, size_t length, int fd = -1);
+
+/*
+ * Receive one message into header and data, data is resized to the
+ * inline bytes following the header. Returns 0 on orderly shutdown.
+ */
+ssize_t receiveBrokerMessage(int socket, void *header, size_t headerLength,
+                             std::vector<uint8_t> &data, UniqueFd &fd);
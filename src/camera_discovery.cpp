@@ -0,0 +1,155 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies Gmbh
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <iostream>
+
+#include <cctype>
+
+#include <broker_client.h>
+#include <camera_discovery.h>
+
+namespace fs = std::filesystem;
+
+static const fs::path v4l2_sysfs_base{"/sys/class/video4linux/"};
+static const std::string subdevPrefix{"v4l-subdev"};
+static const std::string serialPrefix{"sn:"};
+
+/* DeviceSerialNumber in the GenCP technology agnostic bootstrap register map */
+static const uint64_t AbrmSerialNumberAddr = 0x0144;
+static const size_t AbrmSerialNumberLength = 64;
+
+
+static std::optional<int> parseIndex(const std::string &text)
+{
+    int index = 0;
+    auto const end = text.data() + text.size();
+
+    /* Digits only, no sign or whitespace, and in the range of int */
+    auto const [ptr, error] = std::from_chars(text.data(), end, index);
+    if (text.empty() || !::isdigit(static_cast<unsigned char>(text.front())) || error != std::errc{} || ptr != end)
+        return std::nullopt;
+
+    return index;
+}
+
+std::vector<AlviumCamera> discoverCameras(bool withSerial)
+{
+    std::vector<AlviumCamera> cameras;
+    std::error_code error;
+
+    for (auto const &entry : fs::directory_iterator{v4l2_sysfs_base, error}) {
+        auto const entryName = entry.path().filename().string();
+
+        if (entryName.compare(0, subdevPrefix.size(), subdevPrefix) != 0)
+            continue;
+
+        auto const index = parseIndex(entryName.substr(subdevPrefix.size()));
+        if (!index)
+            continue;
+
+        auto const devicePath = entry.path() / "device";
+
+        if (!fs::exists(devicePath / "fw_transfer", error))
+            continue;
+
+        AlviumCamera camera{*index, {}, devicePath, {}};
+
+        std::ifstream nameStream{entry.path() / "name"};
+        std::getline(nameStream, camera.name);
+
+        cameras.push_back(std::move(camera));
+    }
+
+    std::sort(cameras.begin(), cameras.end(), [](auto const &a, auto const &b) {
+        return a.subdev < b.subdev;
+    });
+
+    if (withSerial) {
+        /* A running broker owns the cameras, opening them here would disturb its sessions */
+        auto broker = BrokerClient::connect();
+
+        for (auto &camera : cameras) {
+            if (broker) {
+                char serial[AbrmSerialNumberLength + 1]{};
+
+                if (broker->readRegister(camera.subdev, AbrmSerialNumberAddr, reinterpret_cast<uint8_t*>(serial),
+                                         AbrmSerialNumberLength) == 0)
+                    camera.serial = serial;
+
+                continue;
+            }
+
+            auto gencp = AlviumGenCP::open(camera.subdev);
+            if (!gencp)
+                continue;
+
+            camera.serial = readSerialNumber(*gencp).value_or("");
+        }
+    }
+
+    return cameras;
+}
+
+std::optional<std::string> readSerialNumber(AlviumGenCP &gencp)
+{
+    char serial[AbrmSerialNumberLength + 1]{};
+
+    if (gencp.readRegister(AbrmSerialNumberAddr, reinterpret_cast<uint8_t*>(serial), AbrmSerialNumberLength) < 0)
+        return std::nullopt;
+
+    return std::string{serial};
+}
+
+std::vector<int> resolveCameraTarget(const std::string &target)
+{
+    if (auto const index = parseIndex(target))
+        return {*index};
+
+    std::vector<int> subdevs;
+
+    if (target == "all") {
+        for (auto const &camera : discoverCameras())
+            subdevs.push_back(camera.subdev);
+    } else if (target.compare(0, serialPrefix.size(), serialPrefix) == 0) {
+        auto const serial = target.substr(serialPrefix.size());
+
+        for (auto const &camera : discoverCameras(true)) {
+            if (camera.serial == serial)
+                subdevs.push_back(camera.subdev);
+        }
+    } else {
+        std::cerr << "Invalid camera " << target << std::endl;
+    }
+
+    return subdevs;
+}
+
+std::optional<int> resolveSingleCamera(const std::string &target)
+{
+    auto const subdevs = resolveCameraTarget(target);
+
+    if (subdevs.size() != 1) {
+        std::cerr << (subdevs.empty() ? "No camera matches " : "More than one camera matches ") << target << std::endl;
+        return std::nullopt;
+    }
+
+    return subdevs.front();
+}
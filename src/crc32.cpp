@@ -0,0 +1,250 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <array>
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define JAMCRC_PCLMUL 1
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#define JAMCRC_ARM 1
+#endif
+
+#include <crc32.h>
+
+
+using JamcrcFunction = uint32_t (*)(const uint8_t *data, size_t length, uint32_t state);
+
+using SliceTables = std::array<std::array<uint32_t, 256>, 8>;
+
+static constexpr SliceTables makeSliceTables()
+{
+    SliceTables tables{};
+
+    for (uint32_t i = 0; i < 256; i++)
+        tables[0][i] = jamcrcByte(i, 0);
+
+    for (size_t t = 1; t < tables.size(); t++) {
+        for (uint32_t i = 0; i < 256; i++) {
+            auto const previous = tables[t - 1][i];
+            tables[t][i] = (previous >> 8) ^ tables[0][previous & 0xff];
+        }
+    }
+
+    return tables;
+}
+
+static constexpr SliceTables sliceTables = makeSliceTables();
+
+uint32_t jamcrcPortable(const uint8_t *data, size_t length, uint32_t state)
+{
+    auto const &t = sliceTables;
+
+    while (length >= 8) {
+        uint32_t low, high;
+        memcpy(&low, data, sizeof(low));
+        memcpy(&high, data + 4, sizeof(high));
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        low = __builtin_bswap32(low);
+        high = __builtin_bswap32(high);
+#endif
+        low ^= state;
+
+        state = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24]
+              ^ t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^ t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+
+        data += 8;
+        length -= 8;
+    }
+
+    while (length--)
+        state = (state >> 8) ^ t[0][(state ^ *data++) & 0xff];
+
+    return state;
+}
+
+#ifdef JAMCRC_PCLMUL
+/*
+ * Folds four 128 bit lanes with carry-less multiplication and reduces the
+ * result with Barrett reduction, see Intel's "Fast CRC Computation for
+ * Generic Polynomials Using PCLMULQDQ Instruction". length has to be a
+ * multiple of 16 and at least 64.
+ */
+#define PCLMUL_TARGET __attribute__((target("pclmul,sse4.1")))
+
+PCLMUL_TARGET
+static inline __m128i load(const uint8_t *p)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+/* Multiplies both halves of x by the constants in k and adds next */
+PCLMUL_TARGET
+static inline __m128i fold(__m128i x, __m128i k, __m128i next)
+{
+    auto const low = _mm_clmulepi64_si128(x, k, 0x00);
+    auto const high = _mm_clmulepi64_si128(x, k, 0x11);
+
+    return _mm_xor_si128(_mm_xor_si128(high, low), next);
+}
+
+PCLMUL_TARGET
+static uint32_t jamcrcFold(const uint8_t *data, size_t length, uint32_t state)
+{
+    alignas(16) static const uint64_t k1k2[] = {0x0154442bd4, 0x01c6e41596};
+    alignas(16) static const uint64_t k3k4[] = {0x01751997d0, 0x00ccaa009e};
+    alignas(16) static const uint64_t k5k0[] = {0x0163cd6124, 0x0000000000};
+    alignas(16) static const uint64_t poly[] = {0x01db710641, 0x01f7011641};
+
+    __m128i x1 = _mm_xor_si128(load(data), _mm_cvtsi32_si128(state));
+    __m128i x2 = load(data + 0x10);
+    __m128i x3 = load(data + 0x20);
+    __m128i x4 = load(data + 0x30);
+    __m128i k = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+
+    data += 64;
+    length -= 64;
+
+    while (length >= 64) {
+        x1 = fold(x1, k, load(data));
+        x2 = fold(x2, k, load(data + 0x10));
+        x3 = fold(x3, k, load(data + 0x20));
+        x4 = fold(x4, k, load(data + 0x30));
+
+        data += 64;
+        length -= 64;
+    }
+
+    k = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+
+    x1 = fold(x1, k, x2);
+    x1 = fold(x1, k, x3);
+    x1 = fold(x1, k, x4);
+
+    while (length >= 16) {
+        x1 = fold(x1, k, load(data));
+
+        data += 16;
+        length -= 16;
+    }
+
+    /* 128 to 64 bits */
+    auto const mask = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    x2 = _mm_clmulepi64_si128(x1, k, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+    k = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), k, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    /* Barrett reduction to 32 bits */
+    k = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), k, 0x10);
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask), k, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return _mm_extract_epi32(x1, 1);
+}
+
+static uint32_t jamcrcPclmul(const uint8_t *data, size_t length, uint32_t state)
+{
+    if (length >= 64) {
+        auto const foldLength = length & ~size_t(15);
+
+        state = jamcrcFold(data, foldLength, state);
+        data += foldLength;
+        length -= foldLength;
+    }
+
+    return jamcrcPortable(data, length, state);
+}
+#endif
+
+#ifdef JAMCRC_ARM
+#ifdef __clang__
+__attribute__((target("crc")))
+#else
+__attribute__((target("+crc")))
+#endif
+static uint32_t jamcrcArm(const uint8_t *data, size_t length, uint32_t state)
+{
+    while (length >= 8) {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+
+        state = __crc32d(state, value);
+        data += 8;
+        length -= 8;
+    }
+
+    while (length--)
+        state = __crc32b(state, *data++);
+
+    return state;
+}
+#endif
+
+struct JamcrcImplementation {
+    JamcrcFunction function;
+    const char *name;
+};
+
+static JamcrcImplementation selectImplementation()
+{
+#ifdef JAMCRC_PCLMUL
+    if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1"))
+        return {jamcrcPclmul, "pclmul"};
+#endif
+#ifdef JAMCRC_ARM
+    if (getauxval(AT_HWCAP) & HWCAP_CRC32)
+        return {jamcrcArm, "armv8-crc"};
+#endif
+    return {jamcrcPortable, "slice-by-8"};
+}
+
+/* Selected on first use, so callers running during static initialization are safe */
+static const JamcrcImplementation &implementation()
+{
+    static const JamcrcImplementation selected = selectImplementation();
+
+    return selected;
+}
+
+uint32_t jamcrc(const uint8_t *data, size_t length, uint32_t state)
+{
+    return implementation().function(data, length, state);
+}
+
+const char *jamcrcImplementation()
+{
+    return implementation().name;
+}
+
+uint32_t crc32(const uint8_t *data, size_t length, uint32_t crc)
+{
+    /* JAMCRC is CRC-32 without the final inversion */
+    return ~jamcrc(data, length, ~crc);
+}
@@ -16,55 +16,74 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <array>
+#include <chrono>
 #include <iostream>
 
-#include <file_access.h>
-
+#include <cerrno>
+#include <cstring>
 
+#include <unistd.h>
 
-enum class FileOperation : uint8_t {
-    Open,
-    Close,
-    Read,
-    Write,
-    Delete,
-};
-
+#include <crc32.h>
+#include <file_access.h>
+#include <file_cache.h>
 
-static const uint32_t FileStatusClosed = 0;
-static const uint32_t FileStatusOpen = 0;
+#include "file_access_registers.h"
+#include "transfer_monitor.h"
 
-static const uint64_t FileAccessBufferAddr = 0xD0004000;
-static const uint64_t FileAccessBufferLength = 0x0400;
 
-static const uint64_t StructFileStatusAddr = 0xD0000100;
-static const uint64_t StructFileStatusLength = 0x08;
+/* Additional attempts for a chunk whose transfer failed */
+static const unsigned MaxChunkRetries = 2;
 
-static const uint64_t RegFileOperationExecuteAddr = 0xD0003000;
-static const uint64_t RegFileOperationExecuteLength = 0x08;
+/*
+ * Each attempt programs the device offset again, as it is unknown after a
+ * failure. Only safe for reads, see File::writeChunkRetried() for writes.
+ */
+template<typename Transfer>
+static int withChunkRetries(Transfer transfer)
+{
+    int res = transfer();
 
-static const uint64_t RegFileAccessOffsetAddr = 0xD0005000;
-static const uint64_t RegFileAccessOffsetLength = 0x4;
+    for (unsigned retry = 0; res < 0 && retry < MaxChunkRetries; retry++)
+        res = transfer();
 
-static const uint64_t RegFileSizeBaseAddr = 0xD0005300;
-static const uint64_t RegFileSizeLength = 0x4;
+    return res;
+}
 
-static const uint64_t RegFileAccessLengthAddr = 0xD0005100;
-static const uint64_t RegFileAccessLengthLength = 0x04;
+FileSink fileDescriptorSink(int fd)
+{
+    return [fd](const uint8_t *data, size_t length) {
+        while (length > 0) {
+            auto const written = ::write(fd, data, length);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+
+                return -errno;
+            }
+
+            data += written;
+            length -= written;
+        }
 
-static const uint64_t RegFileSizeMaxAddr = 0xD0005210;
-static const uint64_t RegFileSizeMaxLength = 0x4;
+        return 0;
+    };
+}
 
-struct FileStatus {
-    uint16_t open : 1;
-    uint16_t : 3;
-    uint16_t writeable : 1;
-    uint16_t readable : 1;
-    uint16_t : 10;
-    uint16_t update_status;
-    uint32_t selector_open;
-} __attribute__((packed));
+static uint64_t fileSizeAddr(FileSelector selector)
+{
+    return RegFileSizeBaseAddr + RegFileSizeLength * uint64_t(selector);
+}
 
+/* Registers that only change through file operations issued by this session */
+static void addFileShadowRegions(AlviumGenCP &gencp, FileSelector selector)
+{
+    gencp.addShadowRegion(StructFileStatusAddr, StructFileStatusLength);
+    gencp.addShadowRegion(RegFileSizeMaxAddr, RegFileSizeMaxLength);
+    gencp.addShadowRegion(RegFileAccessLengthAddr, RegFileAccessLengthLength);
+    gencp.addShadowRegion(fileSizeAddr(selector), RegFileSizeLength);
+}
 
 static int readFileStatus(AlviumGenCP &gencp, FileStatus & status)
 {
@@ -86,7 +105,43 @@ int executeFileOperation(AlviumGenCP &gencp, FileOperation operation, FileSelect
         val |= (uint64_t(*open_mode) << 16);
     }
 
-    return gencp.writeRegister(RegFileOperationExecuteAddr, reinterpret_cast<uint8_t*>(&val), sizeof(val));
+    auto const start = std::chrono::steady_clock::now();
+
+    int res = gencp.writeRegister(RegFileOperationExecuteAddr, reinterpret_cast<uint8_t*>(&val), sizeof(val));
+    if (res < 0) {
+        gencp.invalidateShadow(StructFileStatusAddr, StructFileStatusLength);
+        gencp.invalidateShadow(fileSizeAddr(selector), RegFileSizeLength);
+        return res;
+    }
+
+    gencp.recordFileOperation(unsigned(operation), std::chrono::steady_clock::now() - start);
+
+    switch (operation) {
+    case FileOperation::Open:
+        gencp.invalidateShadow(StructFileStatusAddr, StructFileStatusLength);
+
+        /* The firmware may truncate the file */
+        if (*open_mode == FileOpenMode::Write)
+            gencp.invalidateShadow(fileSizeAddr(selector), RegFileSizeLength);
+        break;
+    case FileOperation::Close: {
+        FileStatus const closed{};
+        gencp.updateShadow(StructFileStatusAddr, reinterpret_cast<const uint8_t*>(&closed), sizeof(closed));
+        break;
+    }
+    case FileOperation::Write:
+        gencp.invalidateShadow(fileSizeAddr(selector), RegFileSizeLength);
+        break;
+    case FileOperation::Delete: {
+        uint32_t const empty{};
+        gencp.updateShadow(fileSizeAddr(selector), reinterpret_cast<const uint8_t*>(&empty), sizeof(empty));
+        break;
+    }
+    default:
+        break;
+    }
+
+    return 0;
 }
 
 
@@ -94,6 +149,13 @@ std::optional<File> File::open(AlviumGenCP &gencp, FileSelector selector, FileOp
 {
     FileStatus status{};
 
+    auto const lock = gencp.lock(RequestPriority::Bulk);
+
+    addFileShadowRegions(gencp, selector);
+
+    if (openMode == FileOpenMode::Write)
+        invalidateFileCache(gencp, selector);
+
     int res = readFileStatus(gencp, status);
     if (res < 0)
         return std::nullopt;
@@ -118,30 +180,45 @@ std::optional<File> File::open(AlviumGenCP &gencp, FileSelector selector, FileOp
     return File{gencp, selector, openMode};
 }
 
+std::optional<File> File::openInPlace(AlviumGenCP &gencp, FileSelector selector, size_t expectedLength)
+{
+    auto file = open(gencp, selector, FileOpenMode::Write);
+
+    if (!file || file->length() != ssize_t(expectedLength))
+        return std::nullopt;
+
+    return file;
+}
+
 int File::remove(AlviumGenCP &gencp, FileSelector selector)
 {
+    auto const lock = gencp.lock(RequestPriority::Bulk);
+
+    addFileShadowRegions(gencp, selector);
+    invalidateFileCache(gencp, selector);
+
     return executeFileOperation(gencp, FileOperation::Delete, selector);
 }
 
 File::File(AlviumGenCP &gencp, FileSelector selector, FileOpenMode openMode) : m_gencp{gencp}, m_selector{selector}, m_openMode{openMode}
 {
-    m_refCount = new size_t{1};
+    /* Opening resets the device's file access offset */
+    m_state = new State{1, 0, 0, 0};
 }
 
-File::File(const File &other) :  m_gencp{other.m_gencp}, m_selector{other.m_selector}, m_openMode{other.m_openMode}, m_refCount{other.m_refCount}{
-    (*m_refCount)++;
+File::File(const File &other) :  m_gencp{other.m_gencp}, m_selector{other.m_selector}, m_openMode{other.m_openMode}, m_state{other.m_state}{
+    m_state->refCount++;
 }
 
 File::~File()
 {
-    (*m_refCount)--;
-    if (*m_refCount == 0) {
+    if (--m_state->refCount == 0) {
         executeFileOperation(m_gencp, FileOperation::Close, m_selector);
-        delete m_refCount;
+        delete m_state;
     }
 }
 
-int File::write(const uint8_t *data, size_t length, bool showProgress)
+int File::write(const uint8_t *data, size_t length, const TransferControl &control)
  {
     if (m_openMode == FileOpenMode::Read)
         return -1;
@@ -169,39 +246,119 @@ int File::write(const uint8_t *data, size_t length, bool showProgress)
     uint32_t const chunkSize = std::min(FileAccessBufferLength, uint64_t(optlen));
     uint32_t chunkIdx = 0;
     uint32_t remaining = length;
+    uint32_t crc = 0;
+    TransferMonitor monitor{control, length};
 
     while (remaining > 0) {
         uint32_t const bytesToRead = remaining > chunkSize ? chunkSize : remaining;
         uint32_t const offset = chunkIdx * chunkSize;
 
-        if (showProgress) {
-            uint32_t const written = length - remaining;
-            uint32_t const percent = (100 * written) / length;
-            std::cout << "Writing: " << percent << "% (" << written << "/" << length << ")\r" << std::flush;
-        }
-
-        int res = m_gencp.writeRegister(RegFileAccessLengthAddr, reinterpret_cast<const uint8_t*>(&bytesToRead), sizeof(bytesToRead));
+        int res = writeChunkRetried(offset, data + offset, bytesToRead);
         if (res < 0)
             return res;
 
-        res = m_gencp.writeRegister(FileAccessBufferAddr, data + offset, bytesToRead);
+        crc = crc32(data + offset, bytesToRead, crc);
+        remaining -= bytesToRead;
+        chunkIdx++;
+
+        m_state->crc = crc;
+
+        res = monitor.update(length - remaining);
         if (res < 0)
             return res;
+    }
+
+    return length;
+ }
+
+int File::writeChunk(uint32_t offset, const uint8_t *data, uint32_t length)
+{
+    /* Other threads' control requests may run between chunks, not within one */
+    auto const lock = m_gencp.lock(RequestPriority::Bulk);
+
+    int res = seekDevice(offset);
+    if (res < 0)
+        return res;
+
+    res = m_gencp.writeRegister(RegFileAccessLengthAddr, reinterpret_cast<const uint8_t*>(&length), sizeof(length));
+    if (res < 0)
+        return res;
+
+    res = m_gencp.writeRegister(FileAccessBufferAddr, data, length);
+    if (res < 0)
+        return res;
+
+    m_state->deviceOffset.reset();
 
-        res = executeFileOperation(m_gencp, FileOperation::Write, m_selector);
+    res = executeFileOperation(m_gencp, FileOperation::Write, m_selector);
+    if (res < 0)
+        return res;
+
+    m_state->deviceOffset = offset + length;
+
+    return 0;
+}
+
+/*
+ * A Write whose ack was lost may still have executed and advanced the
+ * device offset. Firmware that ignores new offsets on files opened for
+ * writing would then repeat the chunk behind itself, so a retry needs the
+ * offset read back first and the transfer fails if it did not move.
+ */
+int File::writeChunkRetried(uint32_t offset, const uint8_t *data, uint32_t length)
+{
+    int res = writeChunk(offset, data, length);
+
+    for (unsigned retry = 0; res < 0 && retry < MaxChunkRetries; retry++) {
+        m_state->deviceOffset.reset();
+
+        res = seekDeviceVerified(offset);
         if (res < 0)
             return res;
 
-        remaining -= bytesToRead;
-        chunkIdx++;
+        res = writeChunk(offset, data, length);
     }
 
-    if (showProgress) {
-        uint32_t const written = length - remaining;
-        uint32_t const percent = (100 * written) / length;
-        std::cout << "Written: " << percent << "% (" << written << "/" << length << ")" << std::endl;
+    return res;
+}
+
+ ssize_t File::pwrite(uint32_t offset, const uint8_t *data, size_t length)
+ {
+    if (m_openMode == FileOpenMode::Read)
+        return -1;
+
+    uint32_t maxFileLength{};
+
+    int res = m_gencp.readRegister(RegFileSizeMaxAddr, reinterpret_cast<uint8_t*>(&maxFileLength), sizeof(maxFileLength));
+    if (res < 0)
+        return res;
+
+    if (offset + length > maxFileLength)
+        return -1;
+
+    if (m_state->deviceOffset != offset) {
+        res = seekDeviceVerified(offset);
+        if (res < 0)
+            return res;
     }
 
+    uint32_t const chunkSize = std::min(FileAccessBufferLength, uint64_t(m_gencp.maxWritePacketPayloadSize()));
+    uint32_t done = 0;
+    uint32_t crc = 0;
+
+    while (done < length) {
+        uint32_t const bytesToWrite = std::min<size_t>(length - done, chunkSize);
+
+        res = writeChunkRetried(offset + done, data + done, bytesToWrite);
+        if (res < 0)
+            return res;
+
+        crc = crc32(data + done, bytesToWrite, crc);
+        done += bytesToWrite;
+    }
+
+    m_state->crc = crc;
+
     return length;
  }
 
@@ -215,47 +372,271 @@ int File::write(const uint8_t *data, size_t length, bool showProgress)
     if (length == 0 || length > maxLength)
         return -1;
 
-    auto const optlen = m_gencp.maxReadPacketPayloadSize();
-    if (optlen < 0)
-        return optlen;
+    return pread(0, data, length);
+ }
 
-    uint32_t const chunkSize = std::min(FileAccessBufferLength, uint64_t(optlen));
-    uint32_t chunkIdx = 0;
-    uint32_t remaining = length;
+ ssize_t File::read(const FileSink &sink, const TransferControl &control)
+ {
+    if (m_openMode == FileOpenMode::Write)
+        return -1;
 
-    while (remaining > 0) {
-        uint32_t const bytesToRead = remaining > chunkSize ? chunkSize : remaining;
-        uint32_t const offset = chunkIdx * chunkSize;
+    auto const length = this->length();
 
-        int res = m_gencp.writeRegister(RegFileAccessLengthAddr,
-                                        reinterpret_cast<const uint8_t*>(&bytesToRead),
-                                        sizeof(bytesToRead));
-        if (res < 0)
-            return res;
+    if (length <= 0)
+        return -1;
 
-        res = executeFileOperation(m_gencp, FileOperation::Read, m_selector);
-        if (res < 0)
-            return res;
+    std::array<uint8_t, FileAccessBufferLength> buffer;
+
+    uint32_t const chunkSize = readChunkSize();
+    uint32_t offset = 0;
+    uint32_t crc = 0;
+    TransferMonitor monitor{control, size_t(length)};
+
+    while (offset < length) {
+        auto const res = preadChunks(offset, buffer.data(), chunkSize, crc);
+        if (res <= 0)
+            return res < 0 ? res : -1;
 
-        res = m_gencp.readRegister(FileAccessBufferAddr, data + offset, bytesToRead);
+        int const sinkRes = sink(buffer.data(), res);
+        if (sinkRes < 0)
+            return sinkRes;
+
+        offset += res;
+        m_state->crc = crc;
+
+        int const controlRes = monitor.update(offset);
+        if (controlRes < 0)
+            return controlRes;
+    }
+
+    return length;
+ }
+
+ ssize_t File::read(int fd)
+ {
+    return read(fileDescriptorSink(fd));
+ }
+
+ ssize_t File::read(std::ostream &stream)
+ {
+    return read([&stream](const uint8_t *data, size_t length) {
+        stream.write(reinterpret_cast<const char*>(data), length);
+        return stream ? 0 : -1;
+    });
+ }
+
+uint32_t File::readChunkSize() const
+{
+    return std::min(FileAccessBufferLength, uint64_t(m_gencp.maxReadPacketPayloadSize()));
+}
+
+/*
+ * The device advances its file access offset with every read, so the
+ * offset only has to be programmed when a transfer does not continue
+ * where the previous one ended.
+ */
+int File::seekDevice(uint32_t offset)
+{
+    if (m_state->deviceOffset == offset)
+        return 0;
+
+    m_state->deviceOffset.reset();
+
+    int res = m_gencp.writeRegister(RegFileAccessOffsetAddr, reinterpret_cast<const uint8_t*>(&offset), sizeof(offset));
+    if (res < 0)
+        return res;
+
+    m_state->deviceOffset = offset;
+
+    return 0;
+}
+
+/* Not every firmware accepts a new offset on a file opened for writing, so it is read back */
+int File::seekDeviceVerified(uint32_t offset)
+{
+    int res = seekDevice(offset);
+    if (res < 0)
+        return res;
+
+    uint32_t deviceOffset{};
+
+    res = m_gencp.readRegister(RegFileAccessOffsetAddr, reinterpret_cast<uint8_t*>(&deviceOffset), sizeof(deviceOffset));
+    if (res < 0)
+        return res;
+
+    if (deviceOffset != offset) {
+        m_state->deviceOffset = deviceOffset;
+        return -EIO;
+    }
+
+    return 0;
+}
+
+/* Transfers length bytes at offset through the file access buffer */
+int File::readChunk(uint32_t offset, uint8_t *data, uint32_t length)
+{
+    auto const lock = m_gencp.lock(RequestPriority::Bulk);
+
+    int res = seekDevice(offset);
+    if (res < 0)
+        return res;
+
+    res = m_gencp.writeRegister(RegFileAccessLengthAddr,
+                                    reinterpret_cast<const uint8_t*>(&length),
+                                    sizeof(length));
+    if (res < 0)
+        return res;
+
+    m_state->deviceOffset.reset();
+
+    res = executeFileOperation(m_gencp, FileOperation::Read, m_selector);
+    if (res < 0)
+        return res;
+
+    m_state->deviceOffset = offset + length;
+
+    res = m_gencp.readRegister(FileAccessBufferAddr, data, length);
+    if (res < 0)
+        return res;
+
+    return 0;
+}
+
+ ssize_t File::pread(uint32_t offset, uint8_t *data, size_t length)
+ {
+    uint32_t crc = 0;
+
+    auto const res = preadChunks(offset, data, length, crc);
+    if (res >= 0)
+        m_state->crc = crc;
+
+    return res;
+ }
+
+/* pread() continuing crc over the transferred data */
+ssize_t File::preadChunks(uint32_t offset, uint8_t *data, size_t length, uint32_t &crc)
+{
+    if (m_openMode == FileOpenMode::Write)
+        return -1;
+
+    auto const fileLength = this->length();
+    if (fileLength < 0)
+        return fileLength;
+
+    if (offset >= fileLength)
+        return 0;
+
+    uint32_t const total = std::min<size_t>(length, fileLength - offset);
+    uint32_t const chunkSize = readChunkSize();
+    uint32_t done = 0;
+
+    while (done < total) {
+        uint32_t const bytesToRead = std::min(total - done, chunkSize);
+
+        int res = withChunkRetries([&] { return readChunk(offset + done, data + done, bytesToRead); });
         if (res < 0)
             return res;
 
-        remaining -= bytesToRead;
-        chunkIdx++;
+        crc = crc32(data + done, bytesToRead, crc);
+        done += bytesToRead;
     }
 
-    return length;
+    return total;
+}
+
+ off_t File::seek(off_t offset, int whence)
+ {
+    off_t base = 0;
+
+    switch (whence) {
+    case SEEK_SET:
+        break;
+    case SEEK_CUR:
+        base = m_state->cursor;
+        break;
+    case SEEK_END: {
+        auto const fileLength = length();
+        if (fileLength < 0)
+            return fileLength;
+
+        base = fileLength;
+        break;
+    }
+    default:
+        return -1;
+    }
+
+    if (base + offset < 0 || base + offset > UINT32_MAX)
+        return -1;
+
+    m_state->cursor = base + offset;
+
+    return m_state->cursor;
+ }
+
+ off_t File::tell() const
+ {
+    return m_state->cursor;
+ }
+
+ ssize_t File::readNext(uint8_t *data, size_t length)
+ {
+    auto const res = pread(m_state->cursor, data, length);
+    if (res > 0)
+        m_state->cursor += res;
+
+    return res;
  }
 
  ssize_t File::length() const
  {
     uint32_t fileLength{};
 
-    int res = m_gencp.readRegister(RegFileSizeBaseAddr + RegFileSizeLength * uint64_t(m_selector),
-                                   reinterpret_cast<uint8_t*>(&fileLength), sizeof(fileLength));
+    int res = m_gencp.readRegister(fileSizeAddr(m_selector), reinterpret_cast<uint8_t*>(&fileLength), sizeof(fileLength));
     if (res < 0)
         return res;
 
     return fileLength;
- }
\ No newline at end of file
+ }
+uint32_t File::crc() const
+{
+    return m_state->crc;
+}
+
+/*
+ * The device offers no checksum of the stored file, so the contents are
+ * read back. Only one chunk is buffered at a time.
+ */
+int File::verify(uint32_t offset, const uint8_t *data, size_t length, std::vector<FileRange> *mismatches)
+{
+    if (m_openMode == FileOpenMode::Write)
+        return -1;
+
+    std::array<uint8_t, FileAccessBufferLength> buffer;
+
+    uint32_t const chunkSize = readChunkSize();
+    uint32_t done = 0;
+    uint32_t crc = 0;
+    int result = 0;
+
+    while (done < length) {
+        uint32_t const bytesToRead = std::min<size_t>(length - done, chunkSize);
+
+        auto const res = preadChunks(offset + done, buffer.data(), bytesToRead, crc);
+        if (res < 0)
+            return res;
+
+        if (uint32_t(res) != bytesToRead || memcmp(buffer.data(), data + done, bytesToRead) != 0) {
+            if (mismatches)
+                mismatches->push_back({offset + done, bytesToRead});
+
+            result = -EBADMSG;
+        }
+
+        done += bytesToRead;
+    }
+
+    m_state->crc = crc;
+
+    return result;
+}
@@ -0,0 +1,66 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/* Register map of the Alvium file access feature */
+
+enum class FileOperation : uint8_t {
+    Open,
+    Close,
+    Read,
+    Write,
+    Delete,
+};
+
+
+static const uint32_t FileStatusClosed = 0;
+static const uint32_t FileStatusOpen = 0;
+
+static const uint64_t FileAccessBufferAddr = 0xD0004000;
+static const uint64_t FileAccessBufferLength = 0x0400;
+
+static const uint64_t StructFileStatusAddr = 0xD0000100;
+static const uint64_t StructFileStatusLength = 0x08;
+
+static const uint64_t RegFileOperationExecuteAddr = 0xD0003000;
+static const uint64_t RegFileOperationExecuteLength = 0x08;
+
+static const uint64_t RegFileAccessOffsetAddr = 0xD0005000;
+static const uint64_t RegFileAccessOffsetLength = 0x4;
+
+static const uint64_t RegFileSizeBaseAddr = 0xD0005300;
+static const uint64_t RegFileSizeLength = 0x4;
+
+static const uint64_t RegFileAccessLengthAddr = 0xD0005100;
+static const uint64_t RegFileAccessLengthLength = 0x04;
+
+static const uint64_t RegFileSizeMaxAddr = 0xD0005210;
+static const uint64_t RegFileSizeMaxLength = 0x4;
+
+struct FileStatus {
+    uint16_t open : 1;
+    uint16_t : 3;
+    uint16_t writeable : 1;
+    uint16_t readable : 1;
+    uint16_t : 10;
+    uint16_t update_status;
+    uint32_t selector_open;
+} __attribute__((packed));
@@ -0,0 +1,422 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <array>
+
+#include <cerrno>
+#include <cstring>
+
+#include <crc32.h>
+#include <file_archive.h>
+
+
+static std::string entryName(const ArchiveEntry &entry)
+{
+    return std::string(entry.name, strnlen(entry.name, ArchiveNameLength));
+}
+
+static uint32_t slotLength(size_t length)
+{
+    return (length + ArchiveAlignment - 1) / ArchiveAlignment * ArchiveAlignment;
+}
+
+static uint32_t indexCrc(const ArchiveIndex &index)
+{
+    auto header = index.header;
+    header.indexCrc = 0;
+
+    auto const crc = crc32(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+
+    return crc32(reinterpret_cast<const uint8_t*>(index.entries.data()),
+                 index.entries.size() * sizeof(ArchiveEntry), crc);
+}
+
+static std::vector<uint8_t> serializeIndex(const ArchiveIndex &index)
+{
+    std::vector<uint8_t> buffer(index.length());
+
+    memcpy(buffer.data(), &index.header, sizeof(index.header));
+    memcpy(buffer.data() + sizeof(index.header), index.entries.data(), index.entries.size() * sizeof(ArchiveEntry));
+
+    return buffer;
+}
+
+const ArchiveEntry *ArchiveIndex::find(const std::string &name) const
+{
+    for (auto const &entry : entries)
+        if (entry.name[0] != '\0' && entryName(entry) == name)
+            return &entry;
+
+    return nullptr;
+}
+
+std::vector<std::string> ArchiveIndex::names() const
+{
+    std::vector<std::string> result;
+
+    for (auto const &entry : entries)
+        if (entry.name[0] != '\0')
+            result.push_back(entryName(entry));
+
+    return result;
+}
+
+size_t ArchiveIndex::length() const
+{
+    return sizeof(ArchiveHeader) + entries.size() * sizeof(ArchiveEntry);
+}
+
+std::optional<ArchiveIndex> readArchiveIndex(File &file)
+{
+    ArchiveIndex index{};
+
+    auto res = file.pread(0, reinterpret_cast<uint8_t*>(&index.header), sizeof(index.header));
+    if (res != sizeof(index.header))
+        return std::nullopt;
+
+    if (index.header.magic != ArchiveMagic || index.header.version != ArchiveVersion
+            || index.header.slotCount == 0)
+        return std::nullopt;
+
+    index.entries.resize(index.header.slotCount);
+
+    auto const tableLength = index.entries.size() * sizeof(ArchiveEntry);
+
+    res = file.pread(sizeof(index.header), reinterpret_cast<uint8_t*>(index.entries.data()), tableLength);
+    if (res < 0 || size_t(res) != tableLength)
+        return std::nullopt;
+
+    if (indexCrc(index) != index.header.indexCrc)
+        return std::nullopt;
+
+    auto const end = index.length() + uint64_t(index.header.dataLength);
+
+    for (auto const &entry : index.entries) {
+        if (entry.name[0] == '\0')
+            continue;
+
+        if (entry.offset < index.length() || entry.length > entry.capacity
+                || entry.offset + uint64_t(entry.capacity) > end)
+            return std::nullopt;
+    }
+
+    return index;
+}
+
+ssize_t readArchiveEntry(File &file, const ArchiveEntry &entry, const FileSink &sink)
+{
+    std::array<uint8_t, 0x400> buffer;
+    uint32_t crc = 0;
+    uint32_t done = 0;
+
+    while (done < entry.length) {
+        auto const res = file.pread(entry.offset + done, buffer.data(),
+                                    std::min<size_t>(buffer.size(), entry.length - done));
+        if (res <= 0)
+            return res < 0 ? res : -EBADMSG;
+
+        crc = crc32(buffer.data(), res, crc);
+
+        int const sinkRes = sink(buffer.data(), res);
+        if (sinkRes < 0)
+            return sinkRes;
+
+        done += res;
+    }
+
+    if (crc != entry.crc)
+        return -EBADMSG;
+
+    return done;
+}
+
+ssize_t readArchiveEntry(File &file, const std::string &name, std::vector<uint8_t> &data)
+{
+    auto const index = readArchiveIndex(file);
+    if (!index)
+        return -EINVAL;
+
+    auto const entry = index->find(name);
+    if (!entry)
+        return -ENOENT;
+
+    data.resize(entry->length);
+
+    /* A single pread, the CRC is checked on the result */
+    auto const res = file.pread(entry->offset, data.data(), data.size());
+    if (res < 0)
+        return res;
+
+    if (size_t(res) != data.size() || crc32(data.data(), data.size()) != entry->crc)
+        return -EBADMSG;
+
+    return res;
+}
+
+static int fillEntry(ArchiveEntry &entry, const ArchiveItem &item, uint32_t offset)
+{
+    if (item.name.empty() || item.name.size() >= ArchiveNameLength || item.length > UINT32_MAX)
+        return -EINVAL;
+
+    memset(&entry, 0, sizeof(entry));
+    memcpy(entry.name, item.name.data(), item.name.size());
+
+    entry.offset = offset;
+    entry.length = item.length;
+    entry.capacity = slotLength(std::max(item.length, item.capacity));
+    entry.crc = crc32(item.data, item.length);
+
+    return 0;
+}
+
+ssize_t writeArchive(AlviumGenCP &gencp, FileSelector selector, const std::vector<ArchiveItem> &items,
+                     uint16_t slotCount)
+{
+    if (slotCount == 0 || items.size() > slotCount)
+        return -EINVAL;
+
+    ArchiveIndex index{};
+    index.header.magic = ArchiveMagic;
+    index.header.version = ArchiveVersion;
+    index.header.slotCount = slotCount;
+    index.entries.resize(slotCount);
+
+    uint64_t offset = index.length();
+
+    for (size_t i = 0; i < items.size(); i++) {
+        if (index.find(items[i].name))
+            return -EINVAL;
+
+        int res = fillEntry(index.entries[i], items[i], offset);
+        if (res < 0)
+            return res;
+
+        offset += index.entries[i].capacity;
+        if (offset > UINT32_MAX)
+            return -EINVAL;
+    }
+
+    index.header.dataLength = offset - index.length();
+    index.header.indexCrc = indexCrc(index);
+
+    /* The whole archive is built on the host and written in one go */
+    auto image = serializeIndex(index);
+    image.resize(offset);
+
+    for (size_t i = 0; i < items.size(); i++)
+        memcpy(image.data() + index.entries[i].offset, items[i].data, items[i].length);
+
+    {
+        auto file = File::open(gencp, selector, FileOpenMode::Read);
+        if (!file)
+            return -1;
+
+        auto const currentLength = file->length();
+        if (currentLength < 0)
+            return currentLength;
+
+        file.reset();
+
+        if (currentLength > 0) {
+            int res = File::remove(gencp, selector);
+            if (res < 0)
+                return res;
+        }
+    }
+
+    auto file = File::open(gencp, selector, FileOpenMode::Write);
+    if (!file)
+        return -1;
+
+    int res = file->write(image.data(), image.size());
+    if (res < 0)
+        return res;
+
+    return image.size();
+}
+
+/* Write the entry data and its slot padding, then the index, so an interrupted update fails the entry's CRC */
+static int patchEntry(AlviumGenCP &gencp, FileSelector selector, ArchiveIndex &index, size_t fileLength,
+                      ArchiveEntry &entry, const ArchiveItem &item, size_t &bytesWritten)
+{
+    auto file = File::openInPlace(gencp, selector, fileLength);
+    if (!file)
+        return -1;
+
+    std::vector<uint8_t> slot(entry.capacity);
+    memcpy(slot.data(), item.data, item.length);
+
+    auto res = file->pwrite(entry.offset, slot.data(), slot.size());
+    if (res < 0)
+        return res;
+
+    bytesWritten += slot.size();
+
+    index.header.dataLength = std::max<uint64_t>(index.header.dataLength,
+                                                 entry.offset + uint64_t(entry.capacity) - index.length());
+    index.header.indexCrc = indexCrc(index);
+
+    auto const header = serializeIndex(index);
+
+    res = file->pwrite(0, header.data(), header.size());
+    if (res < 0)
+        return res;
+
+    bytesWritten += header.size();
+
+    return 0;
+}
+
+static int rewriteArchive(AlviumGenCP &gencp, FileSelector selector, const ArchiveIndex &index,
+                          const ArchiveItem &item, UploadResult &result)
+{
+    std::vector<std::vector<uint8_t>> data;
+    std::vector<ArchiveItem> items;
+
+    {
+        auto file = File::open(gencp, selector, FileOpenMode::Read);
+        if (!file)
+            return -1;
+
+        for (auto const &entry : index.entries) {
+            if (entry.name[0] == '\0' || entryName(entry) == item.name)
+                continue;
+
+            data.emplace_back(entry.length);
+
+            auto const res = file->pread(entry.offset, data.back().data(), entry.length);
+            if (res < 0)
+                return res;
+
+            if (size_t(res) != entry.length || crc32(data.back().data(), entry.length) != entry.crc)
+                return -EBADMSG;
+
+            items.push_back({entryName(entry), data.back().data(), entry.length, entry.capacity});
+        }
+    }
+
+    items.push_back(item);
+
+    auto const slotCount = std::max<size_t>(index.header.slotCount, items.size());
+    if (slotCount > UINT16_MAX)
+        return -EINVAL;
+
+    auto const written = writeArchive(gencp, selector, items, slotCount);
+    if (written < 0)
+        return written;
+
+    result.action = UploadAction::Written;
+    result.bytesWritten = written;
+
+    return 0;
+}
+
+int updateArchiveEntry(AlviumGenCP &gencp, FileSelector selector, const ArchiveItem &item, UploadResult &result)
+{
+    result.bytesWritten = 0;
+    result.bytesRepaired = 0;
+
+    ArchiveEntry updated{};
+
+    int res = fillEntry(updated, item, 0);
+    if (res < 0)
+        return res;
+
+    std::optional<ArchiveIndex> index;
+    ssize_t fileLength;
+
+    {
+        auto file = File::open(gencp, selector, FileOpenMode::Read);
+        if (!file)
+            return -1;
+
+        fileLength = file->length();
+        if (fileLength < 0)
+            return fileLength;
+
+        if (fileLength > 0)
+            index = readArchiveIndex(*file);
+    }
+
+    if (!index) {
+        if (fileLength > 0)
+            return -EINVAL;
+
+        auto const written = writeArchive(gencp, selector, {item});
+        if (written < 0)
+            return written;
+
+        result.action = UploadAction::Written;
+        result.bytesWritten = written;
+        return 0;
+    }
+
+    auto const dataEnd = index->length() + index->header.dataLength;
+    auto const current = index->find(item.name);
+
+    if (current && current->length == item.length && current->crc == updated.crc
+            && current->capacity >= updated.capacity) {
+        result.action = UploadAction::Unchanged;
+        return 0;
+    }
+
+    ArchiveEntry *target = nullptr;
+
+    if (current) {
+        target = &index->entries[current - index->entries.data()];
+        updated.offset = target->offset;
+
+        /* The last slot can grow at the end of the file */
+        if (updated.capacity <= target->capacity)
+            updated.capacity = target->capacity;
+        else if (target->offset + target->capacity != dataEnd)
+            target = nullptr;
+    } else {
+        for (auto &entry : index->entries) {
+            if (entry.name[0] == '\0') {
+                target = &entry;
+                updated.offset = dataEnd;
+                break;
+            }
+        }
+    }
+
+    if (target && size_t(fileLength) == dataEnd) {
+        *target = updated;
+
+        res = patchEntry(gencp, selector, *index, fileLength, *target, item, result.bytesWritten);
+        if (res == 0) {
+            result.action = UploadAction::Patched;
+            return 0;
+        }
+
+        /* Start over from what is on the device */
+        result.bytesWritten = 0;
+
+        auto file = File::open(gencp, selector, FileOpenMode::Read);
+        if (!file)
+            return -1;
+
+        index = readArchiveIndex(*file);
+        if (!index)
+            return -EBADMSG;
+    }
+
+    return rewriteArchive(gencp, selector, *index, item, result);
+}
@@ -0,0 +1,139 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies Gmbh
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <file_async.h>
+
+
+TransferHandle::TransferHandle(Transfer transfer, AsyncTransferOptions options)
+    : m_state{std::make_shared<State>()}
+{
+    auto run = [state = m_state, transfer = std::move(transfer), options = std::move(options)]() mutable {
+        auto post = [&options](std::function<void()> task) {
+            if (options.executor)
+                options.executor(std::move(task));
+            else
+                task();
+        };
+
+        TransferControl control;
+        control.cancelled = &state->cancelled;
+        control.progress = [&](const TransferProgress &progress) {
+            {
+                std::lock_guard<std::mutex> lock{state->mutex};
+                state->progress = progress;
+            }
+
+            if (options.onProgress)
+                post([onProgress = options.onProgress, progress] { onProgress(progress); });
+        };
+
+        auto const result = transfer(control);
+
+        /* Releases the File, which may close it, before the caller can touch the session again */
+        transfer = nullptr;
+
+        {
+            std::lock_guard<std::mutex> lock{state->mutex};
+            state->result = result;
+            state->done = true;
+        }
+
+        state->completed.notify_all();
+
+        if (options.onComplete)
+            post([onComplete = options.onComplete, result] { onComplete(result); });
+    };
+
+    m_thread = std::thread{std::move(run)};
+}
+
+TransferHandle &TransferHandle::operator=(TransferHandle &&other)
+{
+    if (this != &other) {
+        join();
+
+        m_state = std::move(other.m_state);
+        m_thread = std::move(other.m_thread);
+    }
+
+    return *this;
+}
+
+TransferHandle::~TransferHandle()
+{
+    join();
+}
+
+void TransferHandle::join()
+{
+    if (!m_thread.joinable())
+        return;
+
+    cancel();
+    m_thread.join();
+}
+
+void TransferHandle::cancel()
+{
+    if (m_state)
+        m_state->cancelled = true;
+}
+
+bool TransferHandle::ready() const
+{
+    std::lock_guard<std::mutex> lock{m_state->mutex};
+
+    return m_state->done;
+}
+
+ssize_t TransferHandle::wait()
+{
+    std::unique_lock<std::mutex> lock{m_state->mutex};
+
+    m_state->completed.wait(lock, [this] { return m_state->done; });
+
+    return m_state->result;
+}
+
+bool TransferHandle::waitFor(std::chrono::nanoseconds timeout)
+{
+    std::unique_lock<std::mutex> lock{m_state->mutex};
+
+    return m_state->completed.wait_for(lock, timeout, [this] { return m_state->done; });
+}
+
+TransferProgress TransferHandle::progress() const
+{
+    std::lock_guard<std::mutex> lock{m_state->mutex};
+
+    return m_state->progress;
+}
+
+TransferHandle readAsync(File file, FileSink sink, AsyncTransferOptions options)
+{
+    return TransferHandle{[file, sink = std::move(sink)](const TransferControl &control) mutable -> ssize_t {
+        return file.read(sink, control);
+    }, std::move(options)};
+}
+
+TransferHandle writeAsync(File file, const uint8_t *data, size_t length, AsyncTransferOptions options)
+{
+    return TransferHandle{[file, data, length](const TransferControl &control) mutable -> ssize_t {
+        return file.write(data, length, control);
+    }, std::move(options)};
+}
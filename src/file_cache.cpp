@@ -0,0 +1,135 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <atomic>
+
+#include <cstdlib>
+#include <cstring>
+
+#include <file_archive.h>
+#include <file_cache.h>
+#include <file_compression.h>
+#include <file_content.h>
+
+#include "session_cache.h"
+
+/* Covers the largest header that carries a fingerprint */
+static constexpr size_t FingerprintLength = sizeof(ContentHeader);
+
+static std::atomic<int> fileCacheSetting{-1};
+
+
+void setFileCacheEnabled(bool enabled)
+{
+    fileCacheSetting = enabled;
+}
+
+bool fileCacheEnabled()
+{
+    auto setting = fileCacheSetting.load();
+
+    if (setting < 0) {
+        auto const env = std::getenv("ALVIUM_FILE_CACHE");
+        setting = env && strcmp(env, "1") == 0;
+        fileCacheSetting = setting;
+    }
+
+    return setting;
+}
+
+/* Only headers whose CRC covers the whole data identify the contents */
+static bool hasFingerprint(const std::vector<uint8_t> &head)
+{
+    uint32_t magic;
+
+    if (head.size() < sizeof(magic))
+        return false;
+
+    memcpy(&magic, head.data(), sizeof(magic));
+
+    return magic == ContentMagic || magic == CompressedMagic || magic == ArchiveMagic;
+}
+
+ssize_t readContentCached(AlviumGenCP &gencp, FileSelector selector, const FileSink &sink, bool *cached)
+{
+    if (cached)
+        *cached = false;
+
+    std::optional<std::string> key;
+
+    if (fileCacheEnabled())
+        key = cameraFileKey(gencp, selector);
+
+    auto file = File::open(gencp, selector, FileOpenMode::Read);
+    if (!file)
+        return -1;
+
+    if (!key)
+        return readContent(*file, sink);
+
+    auto const fileLength = file->length();
+    if (fileLength <= 0)
+        return -1;
+
+    std::vector<uint8_t> head(std::min<size_t>(fileLength, FingerprintLength));
+
+    auto const res = file->pread(0, head.data(), head.size());
+    if (res < 0)
+        return res;
+
+    head.resize(res);
+
+    if (!hasFingerprint(head))
+        return readContent(*file, sink);
+
+    auto const entry = loadCachedFile(*key);
+
+    if (entry && entry->fileLength == uint32_t(fileLength) && entry->head == head) {
+        int const sinkRes = sink(entry->data.data(), entry->data.size());
+        if (sinkRes < 0)
+            return sinkRes;
+
+        if (cached)
+            *cached = true;
+
+        return entry->data.size();
+    }
+
+    CachedFile update{uint32_t(fileLength), head, {}};
+
+    auto const length = readContent(*file, [&](const uint8_t *data, size_t dataLength) {
+        update.data.insert(update.data.end(), data, data + dataLength);
+        return sink(data, dataLength);
+    });
+
+    /* Corrupt data is never cached, readContent checked it against the header */
+    if (length >= 0)
+        storeCachedFile(*key, update);
+
+    return length;
+}
+
+void invalidateFileCache(AlviumGenCP &gencp, FileSelector selector)
+{
+    if (!fileCacheEnabled() && !hasCachedFiles())
+        return;
+
+    auto const key = cameraFileKey(gencp, selector);
+    if (key)
+        removeCachedFile(*key);
+}
@@ -0,0 +1,298 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <array>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include <cerrno>
+#include <cstring>
+
+#include <crc32.h>
+#include <file_compression.h>
+
+#include "lz_codec.h"
+#include "transfer_monitor.h"
+
+static_assert(CompressedBlockSize <= LzMaxBlockSize, "blocks have to fit the codec");
+
+
+static uint32_t headerCrc(CompressedHeader header)
+{
+    header.headerCrc = 0;
+
+    return crc32(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+}
+
+std::optional<CompressedHeader> readCompressedHeader(File &file)
+{
+    CompressedHeader header{};
+
+    auto const res = file.pread(0, reinterpret_cast<uint8_t*>(&header), sizeof(header));
+    if (res != sizeof(header))
+        return std::nullopt;
+
+    if (header.magic != CompressedMagic || header.version != CompressedVersion
+            || header.codec != uint8_t(CompressionCodec::Lz)
+            || header.blockSize == 0 || header.blockSize > CompressedBlockSize
+            || header.headerCrc != headerCrc(header))
+        return std::nullopt;
+
+    return header;
+}
+
+/* Block header and payload, stored as is if compression does not make it smaller */
+static std::vector<uint8_t> compressBlock(const uint8_t *data, size_t length)
+{
+    std::vector<uint8_t> block(sizeof(uint32_t) + lzCompressBound(length));
+
+    uint32_t size = lzCompress(data, length, block.data() + sizeof(uint32_t));
+
+    if (size >= length) {
+        memcpy(block.data() + sizeof(uint32_t), data, length);
+        size = length | CompressedBlockStored;
+    }
+
+    memcpy(block.data(), &size, sizeof(size));
+    block.resize(sizeof(uint32_t) + (size & ~CompressedBlockStored));
+
+    return block;
+}
+
+std::optional<CompressedData> compressData(const uint8_t *data, size_t length)
+{
+    if (length > UINT32_MAX)
+        return std::nullopt;
+
+    CompressedData compressed{};
+
+    auto &header = compressed.header;
+    header.magic = CompressedMagic;
+    header.version = CompressedVersion;
+    header.codec = uint8_t(CompressionCodec::Lz);
+    header.blockSize = CompressedBlockSize;
+    header.rawLength = length;
+    header.rawCrc = crc32(data, length);
+    header.headerCrc = headerCrc(header);
+
+    size_t const blockCount = (length + CompressedBlockSize - 1) / CompressedBlockSize;
+    compressed.blocks.resize(blockCount);
+
+    /* Blocks are independent, every worker takes the next one left */
+    std::atomic<size_t> next{0};
+    auto const worker = [&] {
+        for (size_t i = next++; i < blockCount; i = next++) {
+            auto const offset = i * CompressedBlockSize;
+            compressed.blocks[i] = compressBlock(data + offset, std::min<size_t>(length - offset, CompressedBlockSize));
+        }
+    };
+
+    auto const workerCount = std::min<size_t>(std::max(1U, std::thread::hardware_concurrency()), blockCount);
+    std::vector<std::future<void>> workers;
+
+    for (size_t i = 1; i < workerCount; i++)
+        workers.push_back(std::async(std::launch::async, worker));
+
+    worker();
+
+    for (auto &future : workers)
+        future.get();
+
+    return compressed;
+}
+
+size_t CompressedData::storedLength() const
+{
+    size_t length = sizeof(header);
+
+    for (auto const &block : blocks)
+        length += block.size();
+
+    return length;
+}
+
+ssize_t writeCompressed(File &file, const CompressedData &compressed, const TransferControl &control)
+{
+    auto const &header = compressed.header;
+
+    int res = file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+    if (res < 0)
+        return res;
+
+    TransferMonitor monitor{control, header.rawLength};
+    size_t stored = sizeof(header);
+    size_t done = 0;
+
+    for (auto const &block : compressed.blocks) {
+        auto const written = file.pwrite(stored, block.data(), block.size());
+        if (written < 0)
+            return written;
+
+        stored += block.size();
+        done = std::min<size_t>(done + CompressedBlockSize, header.rawLength);
+
+        /* Progress is reported in uncompressed bytes */
+        res = monitor.update(done);
+        if (res < 0)
+            return res;
+    }
+
+    return stored;
+}
+
+/* Collects the bytes of one block at a time and decompresses it once complete */
+class BlockDecoder {
+public:
+    BlockDecoder(const CompressedHeader &header, const FileSink &sink)
+        : m_header{header}, m_sink{sink}, m_output(header.blockSize)
+    {
+        m_input.reserve(sizeof(uint32_t) + lzCompressBound(header.blockSize));
+    }
+
+    int feed(const uint8_t *data, size_t length)
+    {
+        while (length > 0) {
+            auto const needed = bytesNeeded();
+            if (needed == 0)
+                return -EBADMSG;
+
+            auto const count = std::min(length, needed - m_input.size());
+
+            m_input.insert(m_input.end(), data, data + count);
+            data += count;
+            length -= count;
+
+            if (m_input.size() == needed) {
+                int res = decodeBlock();
+                if (res < 0)
+                    return res;
+            }
+        }
+
+        return 0;
+    }
+
+    size_t decoded() const
+    {
+        return m_decoded;
+    }
+
+    bool complete() const
+    {
+        return m_decoded == m_header.rawLength && m_input.empty() && m_crc == m_header.rawCrc;
+    }
+private:
+    /* Size of the current block including its size field, 0 once all data is decoded */
+    size_t bytesNeeded() const
+    {
+        if (m_decoded == m_header.rawLength)
+            return 0;
+
+        if (m_input.size() < sizeof(uint32_t))
+            return sizeof(uint32_t);
+
+        uint32_t size;
+        memcpy(&size, m_input.data(), sizeof(size));
+
+        return sizeof(uint32_t) + (size & ~CompressedBlockStored);
+    }
+
+    int decodeBlock()
+    {
+        /* Only the size field so far */
+        if (m_input.size() == sizeof(uint32_t) && bytesNeeded() > sizeof(uint32_t))
+            return 0;
+
+        uint32_t size;
+        memcpy(&size, m_input.data(), sizeof(size));
+
+        auto const payload = m_input.data() + sizeof(uint32_t);
+        auto const payloadLength = size & ~CompressedBlockStored;
+        size_t const rawLength = std::min<size_t>(m_header.rawLength - m_decoded, m_header.blockSize);
+        const uint8_t *raw = payload;
+
+        if (size & CompressedBlockStored) {
+            if (payloadLength != rawLength)
+                return -EBADMSG;
+        } else {
+            if (payloadLength > lzCompressBound(m_header.blockSize))
+                return -EBADMSG;
+
+            if (lzDecompress(payload, payloadLength, m_output.data(), rawLength) != ssize_t(rawLength))
+                return -EBADMSG;
+
+            raw = m_output.data();
+        }
+
+        m_crc = crc32(raw, rawLength, m_crc);
+        m_decoded += rawLength;
+
+        int const res = m_sink(raw, rawLength);
+
+        m_input.clear();
+
+        return res;
+    }
+
+    const CompressedHeader m_header;
+    const FileSink &m_sink;
+    std::vector<uint8_t> m_input;
+    std::vector<uint8_t> m_output;
+    size_t m_decoded{0};
+    uint32_t m_crc{0};
+};
+
+ssize_t readCompressed(File &file, const FileSink &sink, const TransferControl &control)
+{
+    auto const header = readCompressedHeader(file);
+    if (!header)
+        return -EBADMSG;
+
+    auto const fileLength = file.length();
+    if (fileLength < 0)
+        return fileLength;
+
+    BlockDecoder decoder{*header, sink};
+    std::array<uint8_t, 0x400> buffer;
+
+    TransferMonitor monitor{control, header->rawLength};
+    uint32_t offset = sizeof(*header);
+
+    while (offset < fileLength && decoder.decoded() < header->rawLength) {
+        auto const res = file.pread(offset, buffer.data(), std::min<size_t>(buffer.size(), fileLength - offset));
+        if (res <= 0)
+            return res < 0 ? res : -1;
+
+        int const decodeRes = decoder.feed(buffer.data(), res);
+        if (decodeRes < 0)
+            return decodeRes;
+
+        offset += res;
+
+        int const controlRes = monitor.update(decoder.decoded());
+        if (controlRes < 0)
+            return controlRes;
+    }
+
+    if (!decoder.complete())
+        return -EBADMSG;
+
+    return header->rawLength;
+}
@@ -0,0 +1,316 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <array>
+
+#include <cerrno>
+#include <cstring>
+
+#include <crc32.h>
+#include <file_compression.h>
+#include <file_content.h>
+
+
+/* Read back and repair rounds of verifyUpload */
+static const unsigned MaxRepairRounds = 2;
+
+std::vector<uint8_t> buildContentHeader(const uint8_t *payload, size_t length, uint32_t flags)
+{
+    size_t const chunkCount = (length + ContentChunkSize - 1) / ContentChunkSize;
+    size_t const headerLength = sizeof(ContentHeader) + chunkCount * sizeof(uint32_t);
+
+    if (headerLength > UINT16_MAX || length > UINT32_MAX)
+        return {};
+
+    std::vector<uint8_t> buffer(headerLength);
+
+    auto header = reinterpret_cast<ContentHeader*>(buffer.data());
+    header->magic = ContentMagic;
+    header->version = ContentVersion;
+    header->headerLength = headerLength;
+    header->flags = flags;
+    header->payloadLength = length;
+    header->chunkSize = ContentChunkSize;
+    header->chunkCount = chunkCount;
+
+    auto table = buffer.data() + sizeof(ContentHeader);
+    uint32_t payloadCrc = 0;
+
+    for (size_t i = 0; i < chunkCount; i++) {
+        auto const chunk = payload + i * ContentChunkSize;
+        auto const chunkLength = std::min<size_t>(length - i * ContentChunkSize, ContentChunkSize);
+
+        uint32_t const chunkCrc = crc32(chunk, chunkLength);
+        memcpy(table + i * sizeof(uint32_t), &chunkCrc, sizeof(chunkCrc));
+
+        payloadCrc = crc32(chunk, chunkLength, payloadCrc);
+    }
+
+    header->payloadCrc = payloadCrc;
+    header->headerCrc = 0;
+    header->headerCrc = crc32(buffer.data(), buffer.size());
+
+    return buffer;
+}
+
+std::optional<ContentInfo> readContentHeader(File &file)
+{
+    ContentInfo info{};
+
+    auto res = file.pread(0, reinterpret_cast<uint8_t*>(&info.header), sizeof(info.header));
+    if (res != sizeof(info.header))
+        return std::nullopt;
+
+    auto &header = info.header;
+
+    if (header.magic != ContentMagic || header.version != ContentVersion)
+        return std::nullopt;
+
+    if (header.chunkSize == 0
+            || header.chunkCount != (uint64_t(header.payloadLength) + header.chunkSize - 1) / header.chunkSize
+            || header.headerLength != sizeof(ContentHeader) + header.chunkCount * sizeof(uint32_t))
+        return std::nullopt;
+
+    info.chunkCrcs.resize(header.chunkCount);
+
+    auto const tableLength = header.chunkCount * sizeof(uint32_t);
+
+    res = file.pread(sizeof(header), reinterpret_cast<uint8_t*>(info.chunkCrcs.data()), tableLength);
+    if (res < 0 || size_t(res) != tableLength)
+        return std::nullopt;
+
+    auto zeroed = header;
+    zeroed.headerCrc = 0;
+
+    auto crc = crc32(reinterpret_cast<const uint8_t*>(&zeroed), sizeof(zeroed));
+    crc = crc32(reinterpret_cast<const uint8_t*>(info.chunkCrcs.data()), tableLength, crc);
+
+    if (crc != header.headerCrc)
+        return std::nullopt;
+
+    return info;
+}
+
+ssize_t readContent(File &file, const FileSink &sink)
+{
+    auto const fileLength = file.length();
+    if (fileLength <= 0)
+        return -1;
+
+    if (readCompressedHeader(file))
+        return readCompressed(file, sink);
+
+    uint32_t offset = 0;
+    uint32_t end = fileLength;
+
+    auto const info = readContentHeader(file);
+
+    if (info) {
+        offset = info->header.headerLength;
+        end = std::min<uint64_t>(end, offset + uint64_t(info->header.payloadLength));
+    }
+
+    std::array<uint8_t, 0x400> buffer;
+    auto const start = offset;
+    uint32_t crc = 0;
+
+    while (offset < end) {
+        auto const res = file.pread(offset, buffer.data(), std::min<size_t>(buffer.size(), end - offset));
+        if (res <= 0)
+            return res < 0 ? res : -1;
+
+        crc = crc32(buffer.data(), res, crc);
+
+        int const sinkRes = sink(buffer.data(), res);
+        if (sinkRes < 0)
+            return sinkRes;
+
+        offset += res;
+    }
+
+    if (info && (end - start != info->header.payloadLength || crc != info->header.payloadCrc))
+        return -EBADMSG;
+
+    return end - start;
+}
+
+static bool sameContent(const ContentInfo &current, const std::vector<uint8_t> &header)
+{
+    auto const tableLength = current.chunkCrcs.size() * sizeof(uint32_t);
+
+    if (header.size() != sizeof(ContentHeader) + tableLength)
+        return false;
+
+    if (memcmp(&current.header, header.data(), sizeof(ContentHeader)) != 0)
+        return false;
+
+    return memcmp(current.chunkCrcs.data(), header.data() + sizeof(ContentHeader), tableLength) == 0;
+}
+
+/* Rewrite the chunks whose CRC differs, the header goes last so an interrupted patch is detected */
+static int patchContent(AlviumGenCP &gencp, FileSelector selector, const ContentInfo &current,
+                        const std::vector<uint8_t> &header, const uint8_t *payload, size_t length,
+                        size_t fileLength, size_t &bytesWritten)
+{
+    auto file = File::openInPlace(gencp, selector, fileLength);
+    if (!file)
+        return -1;
+
+    auto const headerLength = header.size();
+    auto const newCrcs = reinterpret_cast<const uint32_t*>(header.data() + sizeof(ContentHeader));
+    size_t const chunkCount = current.chunkCrcs.size();
+    size_t chunk = 0;
+
+    while (chunk < chunkCount) {
+        if (current.chunkCrcs[chunk] == newCrcs[chunk]) {
+            chunk++;
+            continue;
+        }
+
+        auto first = chunk;
+        while (chunk < chunkCount && current.chunkCrcs[chunk] != newCrcs[chunk])
+            chunk++;
+
+        auto const offset = first * ContentChunkSize;
+        auto const count = std::min(chunk * ContentChunkSize, length) - offset;
+
+        auto const res = file->pwrite(headerLength + offset, payload + offset, count);
+        if (res < 0)
+            return res;
+
+        bytesWritten += count;
+    }
+
+    auto const res = file->pwrite(0, header.data(), headerLength);
+    if (res < 0)
+        return res;
+
+    bytesWritten += headerLength;
+
+    return 0;
+}
+
+int verifyUpload(AlviumGenCP &gencp, FileSelector selector, uint32_t offset, const uint8_t *data, size_t length,
+                 size_t &bytesRepaired)
+{
+    for (unsigned round = 0; ; round++) {
+        std::vector<FileRange> mismatches;
+
+        {
+            auto file = File::open(gencp, selector, FileOpenMode::Read);
+            if (!file)
+                return -1;
+
+            int res = file->verify(offset, data, length, &mismatches);
+            if (res == 0)
+                return 0;
+
+            if (res != -EBADMSG || round == MaxRepairRounds)
+                return res;
+        }
+
+        auto file = File::open(gencp, selector, FileOpenMode::Write);
+        if (!file)
+            return -1;
+
+        for (auto const &range : mismatches) {
+            auto const res = file->pwrite(range.offset, data + (range.offset - offset), range.length);
+            if (res < 0)
+                return res;
+
+            bytesRepaired += range.length;
+        }
+    }
+}
+
+static int verifyContent(AlviumGenCP &gencp, FileSelector selector, const std::vector<uint8_t> &header,
+                         const uint8_t *payload, size_t length, size_t &bytesRepaired)
+{
+    int res = verifyUpload(gencp, selector, 0, header.data(), header.size(), bytesRepaired);
+    if (res < 0)
+        return res;
+
+    return verifyUpload(gencp, selector, header.size(), payload, length, bytesRepaired);
+}
+
+int uploadContent(AlviumGenCP &gencp, FileSelector selector, const uint8_t *payload, size_t length,
+                  UploadResult &result, bool verify)
+{
+    auto const header = buildContentHeader(payload, length);
+    if (header.empty())
+        return -1;
+
+    std::optional<ContentInfo> current;
+    ssize_t currentLength;
+
+    {
+        auto file = File::open(gencp, selector, FileOpenMode::Read);
+        if (!file)
+            return -1;
+
+        currentLength = file->length();
+        if (currentLength < 0)
+            return currentLength;
+
+        if (currentLength > 0)
+            current = readContentHeader(*file);
+    }
+
+    result.bytesWritten = 0;
+    result.bytesRepaired = 0;
+
+    auto const total = header.size() + length;
+
+    if (current && size_t(currentLength) == total && sameContent(*current, header)) {
+        result.action = UploadAction::Unchanged;
+        return 0;
+    }
+
+    if (current && size_t(currentLength) == total && current->header.payloadLength == length
+            && current->header.chunkSize == ContentChunkSize) {
+        int res = patchContent(gencp, selector, *current, header, payload, length,
+                               currentLength, result.bytesWritten);
+        if (res == 0) {
+            result.action = UploadAction::Patched;
+            return verify ? verifyContent(gencp, selector, header, payload, length, result.bytesRepaired) : 0;
+        }
+    }
+
+    if (currentLength > 0) {
+        int res = File::remove(gencp, selector);
+        if (res < 0)
+            return res;
+    }
+
+    auto file = File::open(gencp, selector, FileOpenMode::Write);
+    if (!file)
+        return -1;
+
+    int res = file->write(header.data(), header.size());
+    if (res < 0)
+        return res;
+
+    auto const written = file->pwrite(header.size(), payload, length);
+    if (written < 0)
+        return written;
+
+    result.action = UploadAction::Written;
+    result.bytesWritten = total;
+
+    return verify ? verifyContent(gencp, selector, header, payload, length, result.bytesRepaired) : 0;
+}
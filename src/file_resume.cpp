@@ -0,0 +1,319 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <crc32.h>
+#include <file_resume.h>
+
+#include "session_cache.h"
+#include "transfer_monitor.h"
+
+namespace fs = std::filesystem;
+
+static constexpr unsigned MaxChunkAttempts = 5;
+static constexpr std::chrono::milliseconds InitialBackoff{10};
+static constexpr std::chrono::milliseconds MaxBackoff{500};
+
+/*
+ * Recognizes the camera data of a download by the file length and the
+ * first bytes of the range, see downloadResumable()
+ */
+static constexpr size_t SourceHeadLength = 32;
+
+
+/* Retry a chunk that failed, doubling the delay each time */
+template<typename Transfer>
+static ssize_t withBackoff(const Transfer &transfer)
+{
+    auto backoff = InitialBackoff;
+
+    for (unsigned attempt = 1; ; attempt++) {
+        auto const res = transfer();
+        if (res >= 0 || attempt == MaxChunkAttempts)
+            return res;
+
+        std::this_thread::sleep_for(backoff);
+        backoff = std::min(backoff * 2, MaxBackoff);
+    }
+}
+
+/* Without a key the transfer still runs but can not be resumed, so the serial number read is retried too */
+static std::optional<std::string> journalKey(AlviumGenCP &gencp, FileSelector selector, const char *direction)
+{
+    std::optional<std::string> key;
+
+    withBackoff([&]() -> ssize_t {
+        key = cameraFileKey(gencp, selector);
+        return key ? 0 : -EIO;
+    });
+
+    if (key)
+        *key += direction;
+
+    return key;
+}
+
+static std::optional<File> createFile(AlviumGenCP &gencp, FileSelector selector)
+{
+    {
+        auto file = File::open(gencp, selector, FileOpenMode::Read);
+        if (!file)
+            return std::nullopt;
+
+        auto const length = file->length();
+        if (length < 0)
+            return std::nullopt;
+
+        file.reset();
+
+        if (length > 0 && File::remove(gencp, selector) < 0)
+            return std::nullopt;
+    }
+
+    return File::open(gencp, selector, FileOpenMode::Write);
+}
+
+/* Open the file to continue an upload of data, journal is updated to what the camera holds */
+static std::optional<File> resumeUpload(AlviumGenCP &gencp, FileSelector selector, TransferJournal &journal,
+                                        const uint8_t *data, const std::optional<std::string> &key)
+{
+    auto const previous = key ? loadTransferJournal(*key) : std::nullopt;
+
+    if (!previous || previous->offset != 0 || previous->length != journal.length
+            || previous->sourceCrc != journal.sourceCrc
+            || crc32(data, previous->confirmed) != previous->confirmedCrc)
+        return std::nullopt;
+
+    /* Continue only if the camera kept exactly the confirmed bytes */
+    auto file = File::openInPlace(gencp, selector, previous->confirmed);
+    if (!file)
+        return std::nullopt;
+
+    journal = *previous;
+
+    return file;
+}
+
+ssize_t uploadResumable(AlviumGenCP &gencp, FileSelector selector, const uint8_t *data, size_t length,
+                        const TransferControl &control, bool *resumed)
+{
+    if (resumed)
+        *resumed = false;
+
+    if (length == 0 || length > UINT32_MAX)
+        return -EINVAL;
+
+    auto const key = journalKey(gencp, selector, "-upload");
+
+    TransferJournal journal{0, uint32_t(length), crc32(data, length), 0, 0, {}};
+
+    auto file = resumeUpload(gencp, selector, journal, data, key);
+    if (file) {
+        if (resumed)
+            *resumed = true;
+    } else {
+        auto created = createFile(gencp, selector);
+        if (!created)
+            return -1;
+
+        file.emplace(*created);
+    }
+
+    TransferMonitor monitor{control, length, journal.confirmed};
+
+    while (journal.confirmed < length) {
+        auto const offset = journal.confirmed;
+        auto const count = std::min<size_t>(ResumeChunkSize, length - offset);
+
+        /* File::pwrite programs the access offset again after a failure */
+        auto const res = withBackoff([&] { return file->pwrite(offset, data + offset, count); });
+        if (res < 0)
+            return res;
+
+        journal.confirmedCrc = crc32(data + offset, count, journal.confirmedCrc);
+        journal.confirmed += count;
+
+        if (key)
+            storeTransferJournal(*key, journal);
+
+        int const progressRes = monitor.update(journal.confirmed);
+        if (progressRes < 0)
+            return progressRes;
+    }
+
+    if (key)
+        removeTransferJournal(*key);
+
+    return length;
+}
+
+static int writeAll(int fd, const uint8_t *data, size_t length, off_t offset)
+{
+    while (length > 0) {
+        auto const res = ::pwrite(fd, data, length, offset);
+        if (res < 0) {
+            if (errno == EINTR)
+                continue;
+
+            return -errno;
+        }
+
+        data += res;
+        length -= res;
+        offset += res;
+    }
+
+    return 0;
+}
+
+/* CRC of the first length bytes of fd, std::nullopt if it is shorter */
+static std::optional<uint32_t> prefixCrc(int fd, size_t length)
+{
+    std::array<uint8_t, ResumeChunkSize> buffer;
+    uint32_t crc = 0;
+    size_t done = 0;
+
+    while (done < length) {
+        auto const res = ::pread(fd, buffer.data(), std::min(buffer.size(), length - done), done);
+        if (res < 0 && errno == EINTR)
+            continue;
+
+        if (res <= 0)
+            return std::nullopt;
+
+        crc = crc32(buffer.data(), res, crc);
+        done += res;
+    }
+
+    return crc;
+}
+
+ssize_t downloadResumable(AlviumGenCP &gencp, FileSelector selector, uint32_t offset, size_t length,
+                          const fs::path &output, uint32_t &crc, const TransferControl &control, bool *resumed)
+{
+    if (resumed)
+        *resumed = false;
+
+    auto file = File::open(gencp, selector, FileOpenMode::Read);
+    if (!file)
+        return -1;
+
+    auto const fileLength = file->length();
+    if (fileLength < 0)
+        return fileLength;
+
+    if (offset + uint64_t(length) > uint64_t(fileLength))
+        return -EINVAL;
+
+    std::array<uint8_t, SourceHeadLength> head{};
+    auto const headLength = std::min(head.size(), length);
+
+    auto const headRes = withBackoff([&] { return file->pread(offset, head.data(), headLength); });
+    if (headRes < 0)
+        return headRes;
+
+    auto const fileLength32 = uint32_t(fileLength);
+    auto const sourceCrc = crc32(head.data(), headLength,
+                                 crc32(reinterpret_cast<const uint8_t*>(&fileLength32), sizeof(fileLength32)));
+
+    std::error_code error;
+    auto const target = fs::absolute(output, error).string();
+
+    int const fd = ::open(output.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return -errno;
+
+    TransferJournal journal{offset, uint32_t(length), sourceCrc, 0, 0, target};
+
+    /* Downloads of the same camera file to different outputs each keep their own journal */
+    auto key = journalKey(gencp, selector, "-download");
+    if (key) {
+        std::ostringstream targetHash;
+        targetHash << std::hex << std::setw(8) << std::setfill('0')
+                   << crc32(reinterpret_cast<const uint8_t*>(target.data()), target.size());
+
+        *key += "-" + targetHash.str();
+    }
+    auto const previous = key ? loadTransferJournal(*key) : std::nullopt;
+
+    /* The output may have been changed or cut short since, its CRC tells */
+    if (previous && previous->offset == offset && previous->length == journal.length
+            && previous->sourceCrc == sourceCrc && previous->target == target
+            && prefixCrc(fd, previous->confirmed) == previous->confirmedCrc) {
+        journal = *previous;
+
+        if (resumed)
+            *resumed = true;
+    }
+
+    TransferMonitor monitor{control, length, journal.confirmed};
+    std::vector<uint8_t> buffer(ResumeChunkSize);
+    ssize_t res = 0;
+
+    while (journal.confirmed < length) {
+        auto const done = journal.confirmed;
+        auto const count = std::min<size_t>(ResumeChunkSize, length - done);
+
+        res = withBackoff([&]() -> ssize_t {
+            auto const received = file->pread(offset + done, buffer.data(), count);
+            return received < 0 || size_t(received) == count ? received : -EIO;
+        });
+        if (res < 0)
+            break;
+
+        res = writeAll(fd, buffer.data(), count, done);
+        if (res < 0)
+            break;
+
+        journal.confirmedCrc = crc32(buffer.data(), count, journal.confirmedCrc);
+        journal.confirmed += count;
+
+        if (key)
+            storeTransferJournal(*key, journal);
+
+        res = monitor.update(journal.confirmed);
+        if (res < 0)
+            break;
+    }
+
+    if (res >= 0 && ::ftruncate(fd, length) < 0)
+        res = -errno;
+
+    ::close(fd);
+
+    if (res < 0)
+        return res;
+
+    if (key)
+        removeTransferJournal(*key);
+
+    crc = journal.confirmedCrc;
+
+    return length;
+}
@@ -0,0 +1,200 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <cerrno>
+#include <cstring>
+
+#include <file_archive.h>
+#include <file_compression.h>
+#include <file_resume.h>
+#include <file_upload.h>
+
+#include "file_access_registers.h"
+
+
+static int verifyCompressed(AlviumGenCP &gencp, FileSelector selector, const uint8_t *data, size_t length)
+{
+    auto file = File::open(gencp, selector, FileOpenMode::Read);
+    if (!file)
+        return -1;
+
+    size_t compared = 0;
+
+    auto const res = readCompressed(*file, [&](const uint8_t *block, size_t blockLength) {
+        if (compared + blockLength > length || memcmp(data + compared, block, blockLength) != 0)
+            return -EBADMSG;
+
+        compared += blockLength;
+        return 0;
+    });
+
+    if (res < 0)
+        return res;
+
+    return size_t(res) == length ? 0 : -EBADMSG;
+}
+
+static ssize_t resumeFile(AlviumGenCP &gencp, FileSelector selector, const uint8_t *data, size_t length,
+                          const UploadOptions &options, UploadResult &result, const TransferControl &control)
+{
+    auto const stored = uploadResumable(gencp, selector, data, length, control);
+    if (stored < 0)
+        return stored;
+
+    result.action = UploadAction::Written;
+    result.bytesWritten = stored;
+
+    if (options.verify) {
+        auto const res = verifyUpload(gencp, selector, 0, data, length, result.bytesRepaired);
+        if (res < 0)
+            return res;
+    }
+
+    return stored;
+}
+
+static int checkSizeLimit(AlviumGenCP &gencp, size_t length)
+{
+    uint32_t maxFileLength{};
+
+    int const res = gencp.readRegister(RegFileSizeMaxAddr, reinterpret_cast<uint8_t*>(&maxFileLength),
+                                       sizeof(maxFileLength));
+    if (res < 0)
+        return res;
+
+    return length > maxFileLength ? -EFBIG : 0;
+}
+
+/* Delete the file and write it again, the device does not allow writing over an existing file */
+static ssize_t replaceFile(AlviumGenCP &gencp, FileSelector selector, const uint8_t *data, size_t length,
+                           const UploadOptions &options, UploadResult &result, const TransferControl &control)
+{
+    if (length == 0)
+        return -EINVAL;
+
+    std::optional<CompressedData> compressed;
+
+    if (options.mode == UploadMode::Compressed) {
+        compressed = compressData(data, length);
+        if (!compressed)
+            return -EINVAL;
+    }
+
+    /* Data that does not fit must not cost the current file, so this comes before removing it */
+    int const limitRes = checkSizeLimit(gencp, compressed ? compressed->storedLength() : length);
+    if (limitRes < 0)
+        return limitRes;
+
+    if (options.resume && options.mode == UploadMode::Plain)
+        return resumeFile(gencp, selector, data, length, options, result, control);
+
+    ssize_t currentLength;
+
+    {
+        auto file = File::open(gencp, selector, FileOpenMode::Read);
+        if (!file)
+            return -1;
+
+        currentLength = file->length();
+        if (currentLength < 0)
+            return currentLength;
+    }
+
+    if (currentLength > 0) {
+        auto const res = File::remove(gencp, selector);
+        if (res < 0)
+            return res;
+    }
+
+    auto file = File::open(gencp, selector, FileOpenMode::Write);
+    if (!file)
+        return -1;
+
+    ssize_t stored = length;
+
+    if (compressed) {
+        stored = writeCompressed(*file, *compressed, control);
+    } else {
+        auto const res = file->write(data, length, control);
+        if (res < 0)
+            stored = res;
+    }
+
+    if (stored < 0)
+        return stored;
+
+    file.reset();
+
+    result.action = UploadAction::Written;
+    result.bytesWritten = stored;
+
+    if (options.verify) {
+        auto const res = compressed ? verifyCompressed(gencp, selector, data, length)
+                       : verifyUpload(gencp, selector, 0, data, length, result.bytesRepaired);
+        if (res < 0)
+            return res;
+    }
+
+    return stored;
+}
+
+ssize_t uploadFile(AlviumGenCP &gencp, FileSelector selector, const uint8_t *data, size_t length,
+                   const UploadOptions &options, UploadResult &result, const TransferControl &control)
+{
+    result = UploadResult{};
+
+    switch (options.mode) {
+    case UploadMode::Plain:
+    case UploadMode::Compressed:
+        return replaceFile(gencp, selector, data, length, options, result, control);
+    case UploadMode::Content: {
+        if (length == 0)
+            return -EINVAL;
+
+        auto const res = uploadContent(gencp, selector, data, length, result, options.verify);
+        if (res < 0)
+            return res;
+
+        return result.bytesWritten;
+    }
+    case UploadMode::ArchiveEntry: {
+        auto const res = updateArchiveEntry(gencp, selector, {options.entry, data, length}, result);
+        if (res < 0)
+            return res;
+
+        if (options.verify && result.action != UploadAction::Unchanged) {
+            auto file = File::open(gencp, selector, FileOpenMode::Read);
+            if (!file)
+                return -1;
+
+            std::vector<uint8_t> stored;
+
+            auto const readRes = readArchiveEntry(*file, options.entry, stored);
+            if (readRes < 0)
+                return readRes;
+
+            if (stored.size() != length || memcmp(stored.data(), data, length) != 0)
+                return -EBADMSG;
+        }
+
+        return result.bytesWritten;
+    }
+    }
+
+    return -EINVAL;
+}
@@ -17,110 +17,28 @@
  */
 
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <thread>
 
+#include <cerrno>
+#include <cstddef>
 #include <cstring>
 
-#include <fcntl.h>
-#include <unistd.h>
-
-#include <sys/stat.h>
 #include <sys/types.h>
-
-#include <cppcrc.h>
+#include <sys/uio.h>
 
 #include <gencp.h>
 
-namespace fs = std::filesystem;
-
-struct avt3_fw_transfer {
-    __u16 addr;
-    __u16 len;
-    __u8  rd;
-    __u8  reserved[3];
-} __attribute__((packed));
-
-struct GenCPPrefix {
-    const uint16_t preamble{0x0100};
-    uint32_t crc;
-    const uint16_t channel_id{0x0};
-} __attribute__((packed));
-
-struct GenCPCCD {
-    union {
-        uint16_t flags;
-        uint16_t status_code;
-    };
-    uint16_t command_id;
-    uint16_t length;
-    uint16_t request_id;
-} __attribute__((packed));
-
-struct GenCPReadMemCmd {
-    uint64_t register_address;
-    uint16_t reserved;
-    uint16_t read_length;
-} __attribute__((packed));
-
-using GenCPReadMemAck = uint8_t[];
-
-struct GenCPWriteMemCmd {
-    uint64_t register_address;
-    uint8_t data[];
-} __attribute__((packed));
-
-struct GenCPWriteMemAck {
-    uint16_t reserved;
-    uint16_t length_written;
-} __attribute__((packed));
-
-struct GenCPPendingAck {
-    uint16_t reserved;
-    uint16_t timeout;
-} __attribute__((packed));
-
-
-template<typename SCD>
-struct GenCPPaket {
-    GenCPPrefix prefix;
-    GenCPCCD ccd;
-    SCD scd;
-
-    void calcCRC() {
-        auto start = reinterpret_cast<const uint8_t*>(&prefix.channel_id);
-        auto const size = sizeof(prefix.channel_id) + sizeof(ccd) + ccd.length;
-        prefix.crc = CRC32::JAMCRC::calc(start, size);
-    }
-} __attribute__((packed));
+#include "gencp_protocol.h"
 
+namespace fs = std::filesystem;
 
 static const fs::path v4l2_sysfs_base{"/sys/class/video4linux/"};
 
-template<class T,typename... Args>
-static inline std::unique_ptr<T> makeDynamicStructUniquePtr(size_t arrayLength, Args... args)
-{
-    return std::unique_ptr<T>{new (malloc(sizeof(T) + arrayLength)) T(args...)};
-}
-
-static int readRawInternal(int fd, uint16_t addr, uint8_t *buffer, size_t length)
-{
-    avt3_fw_transfer xfer{};
-    xfer.addr = addr;
-    xfer.len = length;
-    xfer.rd = true;
-
-    if (::pwrite(fd, &xfer, sizeof(xfer), 0) < 0)
-        return errno;
-
-    if (::pread(fd, buffer, length, 0) < 0)
-        return errno;
-
-    return 0;
-}
-
+static const unsigned MaxAckRetries = 2;
 
 std::optional<AlviumGenCP> AlviumGenCP::open(int subdev)
 {
@@ -147,83 +65,237 @@ std::optional<AlviumGenCP> AlviumGenCP::open(int subdev)
         return std::nullopt;
     }
 
-    std::fstream modeStream{modeSysfsPath, std::fstream::in | std::fstream::out};
+    std::string mode;
 
-    if (!modeStream.is_open()) {
-        return std::nullopt;
+    {
+        std::ifstream modeStream{modeSysfsPath};
+
+        if (!modeStream.is_open()) {
+            return std::nullopt;
+        }
+
+        modeStream >> mode;
     }
 
-    modeStream << "gencp";
+    /* Switching the mode resets the driver's transfer state, skip it if possible */
+    if (mode != "gencp") {
+        std::ofstream modeStream{modeSysfsPath};
 
-    auto const transferFd = ::open(fwTransferSysfsPath.c_str(), O_RDWR);
+        if (!modeStream.is_open()) {
+            return std::nullopt;
+        }
+
+        modeStream << "gencp";
+    }
 
-    if (transferFd < 0) {
+    auto transport = SysfsTransport::open(fwTransferSysfsPath);
+
+    if (!transport) {
         return std::nullopt;
     }
 
+    return open(std::move(transport), subdev);
+}
+
+std::optional<AlviumGenCP> AlviumGenCP::open(std::unique_ptr<GenCPTransport> transport, int subdev)
+{
+    if (!transport)
+        return std::nullopt;
+
     uint16_t tmp{};
     std::array<uint16_t, 3> addr;
 
-    if (readRawInternal(transferFd, 0x10, reinterpret_cast<uint8_t*>(&tmp), sizeof(tmp)) < 0)
+    if (transport->read(0x10, reinterpret_cast<uint8_t*>(&tmp), sizeof(tmp)) < 0)
         return std::nullopt;
 
     addr[0] = be16toh(tmp);
 
-    if (readRawInternal(transferFd, addr[0] + 0xC, reinterpret_cast<uint8_t*>(&tmp), sizeof(tmp)) < 0)
+    /* Request (+0x4) and response (+0xC) buffer pointers in one read */
+    std::array<uint8_t, 0xE - 0x4> mailbox;
+
+    if (transport->read(addr[0] + 0x4, mailbox.data(), mailbox.size()) < 0)
         return std::nullopt;
 
-    addr[1] = be16toh(tmp);
+    addr[1] = mailbox[0xC - 0x4] << 8 | mailbox[0xD - 0x4];
+    addr[2] = mailbox[0] << 8 | mailbox[1];
+
+    return AlviumGenCP(std::move(transport), subdev, addr);
+}
 
-    if (readRawInternal(transferFd, addr[0] + 0x4, reinterpret_cast<uint8_t*>(&tmp), sizeof(tmp)) < 0)
-        return std::nullopt;
 
-    addr[2] = be16toh(tmp);
+AlviumGenCP::AlviumGenCP(std::unique_ptr<GenCPTransport> transport, int subdev, std::array<uint16_t, 3> addr)
+    : m_transport{std::move(transport)}, m_subdev{subdev}, m_addr{addr},
+      m_waitStrategy{std::make_unique<AdaptiveWaitStrategy>()},
+      m_scheduler{std::make_unique<GenCPScheduler>()},
+      m_maxPacketSize{std::min(m_transport->maxTransferSize(), 1024UL)}
+{
+    auto const paketWords = (m_maxPacketSize + sizeof(uint64_t) - 1) / sizeof(uint64_t);
 
-    return AlviumGenCP(transferFd, subdev, addr);
+    m_txPaket = std::make_unique<uint64_t[]>(paketWords);
+    m_rxPaket = std::make_unique<uint64_t[]>(paketWords);
+    m_allocationCount += 2;
+
+    reserve(m_batchBuffer, m_maxPacketSize);
+    reserve(m_batchOrder, 16);
 }
 
+size_t AlviumGenCP::allocationCount() const
+{
+    SessionLock const lock{*m_scheduler, RequestPriority::Control};
+
+    return m_allocationCount;
+}
 
-AlviumGenCP::AlviumGenCP(int transferFd, int subdev, std::array<uint16_t, 3> addr)
-    : m_transferFd{transferFd}, m_subdev{subdev}, m_addr{addr}
+template<typename T>
+void AlviumGenCP::reserve(std::vector<T> &vector, size_t size)
 {
+    if (vector.capacity() >= size)
+        return;
 
+    vector.reserve(size);
+    m_allocationCount++;
 }
 
+void AlviumGenCP::setWaitStrategy(std::unique_ptr<GenCPWaitStrategy> strategy)
+{
+    SessionLock const lock{*m_scheduler, RequestPriority::Control};
 
-int AlviumGenCP::writeRaw(uint16_t addr, const uint8_t *buffer, size_t length) const
+    if (strategy)
+        m_waitStrategy = std::move(strategy);
+}
+
+std::chrono::nanoseconds AlviumGenCP::waitTime() const
 {
-    auto tmpSize = sizeof(avt3_fw_transfer) + length;
-    auto tmp = std::make_unique<uint8_t[]>(tmpSize);
+    SessionLock const lock{*m_scheduler, RequestPriority::Control};
 
-    auto xfer = reinterpret_cast<avt3_fw_transfer*>(tmp.get());
-    xfer->addr = addr;
-    xfer->len = length;
-    xfer->rd = false;
-    memcpy(tmp.get() + sizeof(avt3_fw_transfer), buffer, length);
+    return m_waitTime;
+}
 
-    if (::pwrite(m_transferFd, tmp.get(), tmpSize, 0) < 0)
-        return errno;
+void AlviumGenCP::resetWaitTime()
+{
+    SessionLock const lock{*m_scheduler, RequestPriority::Control};
 
-    return 0;
+    m_waitTime = std::chrono::nanoseconds::zero();
+}
+
+
+int AlviumGenCP::writeRaw(uint16_t addr, const uint8_t *buffer, size_t length) const
+{
+    struct iovec const iov{const_cast<uint8_t*>(buffer), length};
+    return writeRawv(addr, &iov, 1);
 }
 
 int AlviumGenCP::readRaw(uint16_t addr, uint8_t *buffer, size_t length) const
 {
-    return readRawInternal(m_transferFd, addr, buffer, length);
+    struct iovec const iov{buffer, length};
+    return readRawv(addr, &iov, 1);
 }
 
-int AlviumGenCP::writePaket(const void *paket, size_t length)
+static size_t iovLength(const struct iovec *iov, int iovCount)
+{
+    size_t length = 0;
+
+    for (int i = 0; i < iovCount; i++)
+        length += iov[i].iov_len;
+
+    return length;
+}
+
+int AlviumGenCP::writeRawv(uint16_t addr, const struct iovec *iov, int iovCount) const
+{
+    auto const start = traceStart();
+
+    int const res = m_transport->writev(addr, iov, iovCount);
+
+    if (m_trace)
+        trace(TraceEventType::RawWrite, start, addr, iovLength(iov, iovCount), res);
+
+    return res;
+}
+
+int AlviumGenCP::readRawv(uint16_t addr, const struct iovec *iov, int iovCount) const
 {
+    auto const start = traceStart();
+
+    int const res = m_transport->readv(addr, iov, iovCount);
+
+    if (m_trace)
+        trace(TraceEventType::RawRead, start, addr, iovLength(iov, iovCount), res);
+
+    return res;
+}
+
+std::chrono::steady_clock::time_point AlviumGenCP::traceStart() const
+{
+    return m_trace ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+}
+
+void AlviumGenCP::trace(TraceEventType type, std::chrono::steady_clock::time_point start,
+                        uint16_t addr, size_t length, int32_t arg) const
+{
+    if (m_trace)
+        m_trace->record(type, m_subdev, start, std::chrono::steady_clock::now(), addr, length, arg);
+}
+
+void AlviumGenCP::setTraceRecorder(TraceRecorder *recorder)
+{
+    SessionLock const lock{*m_scheduler, RequestPriority::Control};
+
+    m_trace = recorder;
+}
+
+int AlviumGenCP::waitHandshake(uint16_t addr, uint8_t expected, HandshakeStage stage,
+                               std::chrono::nanoseconds hint)
+{
+    auto const start = std::chrono::steady_clock::now();
     uint8_t tmp8 = -1;
-    int res = 0;
 
-    do {
-        res = readRaw(m_addr[0] + 0x18, &tmp8, sizeof(tmp8));
+    m_waitStrategy->begin(stage, hint);
+
+    while (1) {
+        int res = readRaw(addr, &tmp8, sizeof(tmp8));
         if (res < 0)
             return res;
-    } while(tmp8 != 0);
 
-    res = writeRaw(m_addr[2], reinterpret_cast<const uint8_t*>(paket), length);
+        m_handshakePolls++;
+
+        if (tmp8 == expected)
+            break;
+
+        auto const delay = m_waitStrategy->nextDelay();
+        if (delay > std::chrono::nanoseconds::zero())
+            std::this_thread::sleep_for(delay);
+    }
+
+    auto const elapsed = std::chrono::steady_clock::now() - start;
+
+    m_waitStrategy->complete(stage, elapsed);
+    m_waitTime += elapsed;
+
+    trace(TraceEventType::Handshake, start, addr, 0, int32_t(stage));
+
+    return 0;
+}
+
+int AlviumGenCP::writePaket(const void *paket, size_t length)
+{
+    struct iovec const iov{const_cast<void*>(paket), length};
+    return writePaket(&iov, 1);
+}
+
+int AlviumGenCP::writePaket(const struct iovec *iov, int iovCount)
+{
+    uint8_t tmp8 = -1;
+    size_t const length = iovLength(iov, iovCount);
+
+    auto const polls = m_handshakePolls;
+    auto const start = traceStart();
+
+    int res = waitHandshake(m_addr[0] + 0x18, 0, HandshakeStage::RequestIdle);
+    if (res < 0)
+        return res;
+
+    res = writeRawv(m_addr[2], iov, iovCount);
     if (res < 0) 
         return res;
 
@@ -238,11 +310,9 @@ int AlviumGenCP::writePaket(const void *paket, size_t length)
     if (res < 0)
         return res;
 
-    do {
-        res = readRaw(m_addr[0] + 0x18, &tmp8, sizeof(tmp8));
-        if (res < 0)
-            return res;
-    } while(tmp8 != 2);
+    res = waitHandshake(m_addr[0] + 0x18, 2, HandshakeStage::RequestAccepted);
+    if (res < 0)
+        return res;
 
     tmp8 = 0;
 
@@ -250,25 +320,33 @@ int AlviumGenCP::writePaket(const void *paket, size_t length)
     if (res < 0) 
         return res;
 
+    m_stats.packetsSent++;
+    m_stats.bytesSent += length;
+    m_stats.handshakePolls.record(m_handshakePolls - polls);
+
+    trace(TraceEventType::WritePaket, start, m_addr[2], length, m_handshakePolls - polls);
+
     return 0;
 }
 
-int AlviumGenCP::readPaket(void *paket, size_t length)
+int AlviumGenCP::readPaket(void *paket, size_t length, std::chrono::nanoseconds hint)
+{
+    struct iovec const iov{paket, length};
+    return readPaket(&iov, 1, hint);
+}
+
+/* Scatters the ack over iov, the part of iov beyond the ack length is left untouched */
+int AlviumGenCP::readPaket(const struct iovec *iov, int iovCount, std::chrono::nanoseconds hint)
 {
     uint8_t tmp8 = -1;
-    int res = 0;
+    size_t const length = iovLength(iov, iovCount);
 
-    while (1) {
-        res = readRaw(m_addr[0] + 0x1C, &tmp8, sizeof(tmp8));
-        if (res < 0)
-            return res;
+    auto const polls = m_handshakePolls;
+    auto const start = traceStart();
 
-        if (tmp8 != 1) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
-        } else {
-            break;
-        }
-    }
+    int res = waitHandshake(m_addr[0] + 0x1C, 1, HandshakeStage::ResponseReady, hint);
+    if (res < 0)
+        return res;
 
     uint16_t tmp16{};
 
@@ -282,24 +360,32 @@ int AlviumGenCP::readPaket(void *paket, size_t length)
     if (tmp16 > length)
         return -1;
 
-    res = readRaw(m_addr[1], reinterpret_cast<uint8_t*>(paket), tmp16);
+    std::array<struct iovec, GenCPTransport::MaxIovCount> ackIov;
+    size_t remaining = tmp16;
+    int ackIovCount = 0;
+
+    while (remaining > 0 && ackIovCount < iovCount) {
+        ackIov[ackIovCount] = iov[ackIovCount];
+        ackIov[ackIovCount].iov_len = std::min(remaining, iov[ackIovCount].iov_len);
+        remaining -= ackIov[ackIovCount].iov_len;
+        ackIovCount++;
+    }
+
+    res = readRawv(m_addr[1], ackIov.data(), ackIovCount);
     if (res < 0)
         return res;
 
+    auto const crcValid = !m_ackCrcCheck || checkAckCRC(ackIov.data(), ackIovCount);
+
     tmp8 = 2;
 
     res = writeRaw(m_addr[0] + 0x1C, &tmp8, sizeof(tmp8));
     if (res < 0) 
         return res;
 
-    while (1) {
-        res = readRaw(m_addr[0] + 0x1C, &tmp8, sizeof(tmp8));
-        if (tmp8 != 2) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
-        } else {
-            break;
-        }
-    }
+    res = waitHandshake(m_addr[0] + 0x1C, 2, HandshakeStage::ResponseReleased);
+    if (res < 0)
+        return res;
 
     tmp8 = 0;
 
@@ -307,10 +393,296 @@ int AlviumGenCP::readPaket(void *paket, size_t length)
     if (res < 0) 
         return res;
 
+    m_stats.packetsReceived++;
+    m_stats.bytesReceived += tmp16;
+    m_stats.handshakePolls.record(m_handshakePolls - polls);
+
+    trace(TraceEventType::ReadPaket, start, m_addr[1], tmp16, m_handshakePolls - polls);
+
+    /* Reported only after the mailbox was released so the next request can proceed */
+    if (!crcValid) {
+        m_stats.ackCrcErrors++;
+        return -EBADMSG;
+    }
+
     return 0;
 }
 
+/* Checks the CRC of an ack scattered over iov, iov[0] must hold at least the prefix */
+bool AlviumGenCP::checkAckCRC(const struct iovec *iov, int iovCount) const
+{
+    if (iovCount < 1 || iov[0].iov_len < sizeof(GenCPPrefix))
+        return false;
+
+    auto const prefix = static_cast<const GenCPPrefix*>(iov[0].iov_base);
+    auto const first = static_cast<const uint8_t*>(iov[0].iov_base);
+
+    uint32_t crc = prefix->channel_id == GenCPChannelId
+                 ? GenCPChannelCrcState
+                 : jamcrc(first + offsetof(GenCPPrefix, channel_id), sizeof(prefix->channel_id));
+
+    crc = jamcrc(first + sizeof(GenCPPrefix), iov[0].iov_len - sizeof(GenCPPrefix), crc);
+
+    for (int i = 1; i < iovCount; i++)
+        crc = jamcrc(static_cast<const uint8_t*>(iov[i].iov_base), iov[i].iov_len, crc);
+
+    return crc == prefix->crc;
+}
+
+void AlviumGenCP::setAckCrcCheck(bool enabled)
+{
+    SessionLock const lock{*m_scheduler, RequestPriority::Control};
+
+    m_ackCrcCheck = enabled;
+}
+
+GenCPStats AlviumGenCP::stats() const
+{
+    SessionLock const lock{*m_scheduler, RequestPriority::Control};
+
+    auto stats = m_stats;
+    stats.controlWait = m_scheduler->controlWait();
+
+    return stats;
+}
+
+void AlviumGenCP::resetStats()
+{
+    SessionLock const lock{*m_scheduler, RequestPriority::Control};
+
+    m_stats = GenCPStats{};
+    m_scheduler->resetControlWait();
+}
+
+SessionLock AlviumGenCP::lock(RequestPriority priority)
+{
+    return SessionLock{*m_scheduler, priority};
+}
+
+/* since marks the first pending ack of a command */
+void AlviumGenCP::notePendingAck(std::chrono::steady_clock::time_point &since)
+{
+    m_stats.pendingAcks++;
+
+    if (since == std::chrono::steady_clock::time_point{})
+        since = std::chrono::steady_clock::now();
+}
+
+void AlviumGenCP::recordPendingAckWait(std::chrono::steady_clock::time_point since)
+{
+    if (since != std::chrono::steady_clock::time_point{})
+        m_stats.pendingAckWait.record((std::chrono::steady_clock::now() - since).count());
+}
+
+void AlviumGenCP::recordFileOperation(unsigned operation, std::chrono::nanoseconds latency)
+{
+    SessionLock const lock{*m_scheduler, RequestPriority::Control};
+
+    if (operation < m_stats.fileOperationLatency.size())
+        m_stats.fileOperationLatency[operation].record(latency.count());
+}
+
 int AlviumGenCP::writeRegister(uint64_t addr, const uint8_t *buffer, size_t length)
+{
+    SessionLock const lock{*m_scheduler, RequestPriority::Control};
+
+    auto region = findShadowRegion(addr, length);
+
+    if (region && region->valid && memcmp(region->data.data(), buffer, length) == 0) {
+        m_stats.shadowHits++;
+        return 0;
+    }
+
+    invalidateShadow(addr, length);
+
+    auto const start = std::chrono::steady_clock::now();
+
+    int res = writeMem(addr, buffer, length);
+    if (res < 0)
+        return res;
+
+    m_stats.writeRegisterLatency.record((std::chrono::steady_clock::now() - start).count());
+    m_stats.writeRegisterBytes.record(length);
+
+    if (region) {
+        memcpy(region->data.data(), buffer, length);
+        region->valid = true;
+    }
+
+    return 0;
+}
+
+int AlviumGenCP::readRegister(uint64_t addr, uint8_t *buffer, size_t length)
+{
+    SessionLock const lock{*m_scheduler, RequestPriority::Control};
+
+    auto region = findShadowRegion(addr, length);
+
+    if (region && region->valid) {
+        memcpy(buffer, region->data.data(), length);
+        m_stats.shadowHits++;
+        return 0;
+    }
+
+    auto const start = std::chrono::steady_clock::now();
+
+    int res = readMem(addr, buffer, length);
+    if (res < 0)
+        return res;
+
+    m_stats.readRegisterLatency.record((std::chrono::steady_clock::now() - start).count());
+    m_stats.readRegisterBytes.record(length);
+
+    if (region) {
+        memcpy(region->data.data(), buffer, length);
+        region->valid = true;
+    }
+
+    return 0;
+}
+
+int AlviumGenCP::readRegisters(const RegisterRead *ops, size_t count, size_t maxGap)
+{
+    SessionLock const lock{*m_scheduler, RequestPriority::Control};
+
+    m_batchOrder.clear();
+    reserve(m_batchOrder, count);
+
+    for (size_t i = 0; i < count; i++) {
+        auto region = findShadowRegion(ops[i].addr, ops[i].length);
+
+        if (region && region->valid) {
+            memcpy(ops[i].buffer, region->data.data(), ops[i].length);
+        } else if (ops[i].length > 0) {
+            m_batchOrder.push_back(i);
+        }
+    }
+
+    std::sort(m_batchOrder.begin(), m_batchOrder.end(), [ops](size_t a, size_t b) {
+        return ops[a].addr < ops[b].addr;
+    });
+
+    auto const maxReadDataSize = maxReadPacketPayloadSize();
+    size_t first = 0;
+
+    while (first < m_batchOrder.size()) {
+        auto const start = ops[m_batchOrder[first]].addr;
+        auto end = start + ops[m_batchOrder[first]].length;
+        size_t last = first + 1;
+
+        while (last < m_batchOrder.size()) {
+            auto const &next = ops[m_batchOrder[last]];
+            auto const nextEnd = std::max(end, next.addr + next.length);
+
+            if (next.addr > end + maxGap || nextEnd - start > maxReadDataSize)
+                break;
+
+            end = nextEnd;
+            last++;
+        }
+
+        if (last - first == 1) {
+            auto const &op = ops[m_batchOrder[first]];
+
+            int res = readRegister(op.addr, op.buffer, op.length);
+            if (res < 0)
+                return res;
+        } else {
+            reserve(m_batchBuffer, end - start);
+            m_batchBuffer.resize(end - start);
+
+            int res = readMem(start, m_batchBuffer.data(), end - start);
+            if (res < 0)
+                return res;
+
+            for (auto i = first; i < last; i++) {
+                auto const &op = ops[m_batchOrder[i]];
+
+                memcpy(op.buffer, &m_batchBuffer[op.addr - start], op.length);
+                updateShadow(op.addr, op.buffer, op.length);
+            }
+        }
+
+        first = last;
+    }
+
+    return 0;
+}
+
+int AlviumGenCP::writeRegisters(const RegisterWrite *ops, size_t count)
+{
+    SessionLock const lock{*m_scheduler, RequestPriority::Control};
+
+    m_batchOrder.clear();
+    reserve(m_batchOrder, count);
+
+    for (size_t i = 0; i < count; i++) {
+        auto region = findShadowRegion(ops[i].addr, ops[i].length);
+
+        if (region && region->valid && memcmp(region->data.data(), ops[i].buffer, ops[i].length) == 0)
+            continue;
+
+        if (ops[i].length > 0) {
+            m_batchOrder.push_back(i);
+        }
+    }
+
+    std::stable_sort(m_batchOrder.begin(), m_batchOrder.end(), [ops](size_t a, size_t b) {
+        return ops[a].addr < ops[b].addr;
+    });
+
+    auto const maxWriteDataSize = maxWritePacketPayloadSize();
+    size_t first = 0;
+
+    while (first < m_batchOrder.size()) {
+        auto const start = ops[m_batchOrder[first]].addr;
+        auto end = start + ops[m_batchOrder[first]].length;
+        size_t last = first + 1;
+
+        while (last < m_batchOrder.size()) {
+            auto const &next = ops[m_batchOrder[last]];
+
+            if (next.addr != end || end + next.length - start > maxWriteDataSize)
+                break;
+
+            end += next.length;
+            last++;
+        }
+
+        if (last - first == 1) {
+            auto const &op = ops[m_batchOrder[first]];
+
+            int res = writeRegister(op.addr, op.buffer, op.length);
+            if (res < 0)
+                return res;
+        } else {
+            reserve(m_batchBuffer, end - start);
+            m_batchBuffer.resize(end - start);
+
+            for (auto i = first; i < last; i++) {
+                auto const &op = ops[m_batchOrder[i]];
+                memcpy(&m_batchBuffer[op.addr - start], op.buffer, op.length);
+            }
+
+            invalidateShadow(start, end - start);
+
+            int res = writeMem(start, m_batchBuffer.data(), end - start);
+            if (res < 0)
+                return res;
+
+            for (auto i = first; i < last; i++) {
+                auto const &op = ops[m_batchOrder[i]];
+                updateShadow(op.addr, op.buffer, op.length);
+            }
+        }
+
+        first = last;
+    }
+
+    return 0;
+}
+
+int AlviumGenCP::writeMem(uint64_t addr, const uint8_t *buffer, size_t length)
 {
     auto const maxWriteDataSize = maxWritePacketPayloadSize();
     size_t remaining = length;
@@ -320,38 +692,49 @@ int AlviumGenCP::writeRegister(uint64_t addr, const uint8_t *buffer, size_t leng
         auto const bytesToRead = remaining > maxWriteDataSize ? maxWriteDataSize : remaining;
         auto const offset = currentChunk * maxWriteDataSize;
 
-        auto const cmdLength = sizeof(GenCPPaket<GenCPWriteMemCmd>) + bytesToRead;
-        auto cmd = makeDynamicStructUniquePtr<GenCPPaket<GenCPWriteMemCmd>>(bytesToRead);
+        auto cmd = new (m_txPaket.get()) GenCPPaket<GenCPWriteMemCmd>();
         cmd->scd.register_address = addr + offset;
-        memcpy(cmd->scd.data, buffer + offset, bytesToRead);
 
         cmd->ccd.flags = (1 << 14);
         cmd->ccd.command_id = 0x0802;
         cmd->ccd.length = sizeof(cmd->scd) + bytesToRead;
         cmd->ccd.request_id = m_requestId;
 
-        cmd->calcCRC();
+        cmd->calcCRC(buffer + offset, bytesToRead);
+
+        /* The data is sent straight from the caller's buffer */
+        struct iovec const iov[] = {
+            {cmd, sizeof(*cmd)},
+            {const_cast<uint8_t*>(buffer + offset), bytesToRead},
+        };
 
-        int res = writePaket(cmd.get(), cmdLength);
+        int res = writePaket(iov, 2);
         if (res < 0)
             return res;
 
         GenCPPaket<GenCPWriteMemAck> ack{};
+        std::chrono::nanoseconds hint{};
+        std::chrono::steady_clock::time_point pendingSince{};
 
         do {
             memset(&ack, 0, sizeof(ack));
 
-            res = readPaket(&ack, sizeof(ack));
+            res = readPaket(&ack, sizeof(ack), hint);
             if (res < 0)
                 return res;
 
+            /* Re-poll for the final ack instead of sleeping the whole announced timeout */
             if (ack.ccd.command_id == 0x0805) {
                 auto const pendingAck = reinterpret_cast<GenCPPendingAck*>(&ack.scd);
-                std::this_thread::sleep_for(std::chrono::milliseconds(pendingAck->timeout));
+                hint = std::chrono::milliseconds(pendingAck->timeout);
+                notePendingAck(pendingSince);
+                trace(TraceEventType::PendingAck, traceStart(), m_addr[1], sizeof(ack), pendingAck->timeout);
             }
 
         } while (ack.ccd.command_id == 0x805);
 
+        recordPendingAckWait(pendingSince);
+
 
         if(ack.ccd.command_id != 0x0803)
             return -1;
@@ -373,9 +756,8 @@ int AlviumGenCP::writeRegister(uint64_t addr, const uint8_t *buffer, size_t leng
     return 0;
 }
 
-int AlviumGenCP::readRegister(uint64_t addr, uint8_t *buffer, size_t length)
+int AlviumGenCP::readMem(uint64_t addr, uint8_t *buffer, size_t length)
 {
-
     size_t remaining = length;
     size_t currentChunk = 0;
 
@@ -385,39 +767,78 @@ int AlviumGenCP::readRegister(uint64_t addr, uint8_t *buffer, size_t length)
         auto const bytesToRead = remaining > maxReadDataSize ? maxReadDataSize : remaining;
         auto const offset = currentChunk * maxReadDataSize;
 
-        GenCPPaket<GenCPReadMemCmd> cmd{};
-        cmd.scd.register_address = addr + offset;
-        cmd.scd.read_length = bytesToRead;
+        int res = readMemChunk(addr + offset, buffer + offset, bytesToRead);
 
-        cmd.ccd.flags = (1 << 14);
-        cmd.ccd.command_id = 0x0800;
-        cmd.ccd.length = sizeof(cmd.scd);
-        cmd.ccd.request_id = 0;
-        cmd.calcCRC();
+        /* ReadMem has no side effects, so a corrupted ack is simply requested again */
+        for (unsigned retry = 0; res == -EBADMSG && retry < MaxAckRetries; retry++)
+            res = readMemChunk(addr + offset, buffer + offset, bytesToRead);
 
-        int res = writePaket(&cmd, sizeof(cmd));
         if (res < 0)
             return res;
 
-        auto const ackLength = sizeof(GenCPPaket<GenCPReadMemAck>) + bytesToRead;
+        currentChunk++;
+        remaining -= bytesToRead;
+    }
+
+    return 0;
+}
+
+int AlviumGenCP::readMemChunk(uint64_t addr, uint8_t *buffer, size_t bytesToRead)
+{
+    GenCPPaket<GenCPReadMemCmd> cmd{};
+    cmd.scd.register_address = addr;
+    cmd.scd.read_length = bytesToRead;
+
+    cmd.ccd.flags = (1 << 14);
+    cmd.ccd.command_id = 0x0800;
+    cmd.ccd.length = sizeof(cmd.scd);
+    cmd.ccd.request_id = 0;
+    cmd.calcCRC();
+
+    int res = writePaket(&cmd, sizeof(cmd));
+    if (res < 0)
+        return res;
+
+    /*
+     * Only the ack header goes to the side buffer, the data lands in the
+     * caller's buffer. Reads shorter than a pending ack are received as a
+     * whole so a pending ack still fits.
+     */
+    auto ack = new (m_rxPaket.get()) GenCPPaket<GenCPReadMemAck>();
+    auto const scatter = bytesToRead >= sizeof(GenCPPendingAck);
+    struct iovec const iov[] = {
+        {ack, scatter ? sizeof(*ack) : m_maxPacketSize},
+        {buffer, bytesToRead},
+    };
 
-        auto ack = makeDynamicStructUniquePtr<GenCPPaket<GenCPReadMemAck>>(bytesToRead);
+    std::chrono::nanoseconds hint{};
+    std::chrono::steady_clock::time_point pendingSince{};
 
-        res = readPaket(ack.get(), ackLength);
+    do {
+        res = readPaket(iov, scatter ? 2 : 1, hint);
         if (res < 0)
             return res;
 
-        if(ack->ccd.command_id != 0x0801)
-            return -1;
+        if (ack->ccd.command_id == 0x0805) {
+            GenCPPendingAck pendingAck{};
+            memcpy(&pendingAck, scatter ? buffer : &ack->scd[0], sizeof(pendingAck));
+            hint = std::chrono::milliseconds(pendingAck.timeout);
+            notePendingAck(pendingSince);
+            trace(TraceEventType::PendingAck, traceStart(), m_addr[1], sizeof(*ack), pendingAck.timeout);
+        }
 
-        if(ack->ccd.status_code != 0x0)
-            return -1;
+    } while (ack->ccd.command_id == 0x0805);
 
-        memcpy(buffer + offset, &ack->scd[0], bytesToRead);
+    recordPendingAckWait(pendingSince);
 
-        currentChunk++;
-        remaining -= bytesToRead;
-    }
+    if(ack->ccd.command_id != 0x0801)
+        return -1;
+
+    if(ack->ccd.status_code != 0x0)
+        return -1;
+
+    if (!scatter)
+        memcpy(buffer, &ack->scd[0], bytesToRead);
 
     return 0;
 }
@@ -425,11 +846,7 @@ int AlviumGenCP::readRegister(uint64_t addr, uint8_t *buffer, size_t length)
 
 size_t AlviumGenCP::maxPacketSize() const
 {
-    struct stat stat{};
-
-    fstat(m_transferFd, &stat);
-
-    return std::min(stat.st_size - sizeof(avt3_fw_transfer), 1024UL);
+    return m_maxPacketSize;
 }
 
 size_t AlviumGenCP::maxReadPacketPayloadSize() const
@@ -440,4 +857,59 @@ size_t AlviumGenCP::maxReadPacketPayloadSize() const
 size_t AlviumGenCP::maxWritePacketPayloadSize() const
 {
     return maxPacketSize() - sizeof(GenCPPaket<GenCPWriteMemCmd>);
-}
\ No newline at end of file
+}
+
+void AlviumGenCP::addShadowRegion(uint64_t addr, size_t length)
+{
+    SessionLock const lock{*m_scheduler, RequestPriority::Control};
+
+    if (findShadowRegion(addr, length))
+        return;
+
+    invalidateShadow(addr, length);
+
+    m_shadow.push_back({addr, std::vector<uint8_t>(length), false});
+}
+
+void AlviumGenCP::updateShadow(uint64_t addr, const uint8_t *buffer, size_t length)
+{
+    SessionLock const lock{*m_scheduler, RequestPriority::Control};
+
+    auto region = findShadowRegion(addr, length);
+
+    if (!region) {
+        invalidateShadow(addr, length);
+        return;
+    }
+
+    memcpy(region->data.data(), buffer, length);
+    region->valid = true;
+}
+
+void AlviumGenCP::invalidateShadow(uint64_t addr, size_t length)
+{
+    SessionLock const lock{*m_scheduler, RequestPriority::Control};
+
+    for (auto &region : m_shadow) {
+        if (addr < region.addr + region.data.size() && region.addr < addr + length)
+            region.valid = false;
+    }
+}
+
+void AlviumGenCP::invalidateShadow()
+{
+    SessionLock const lock{*m_scheduler, RequestPriority::Control};
+
+    for (auto &region : m_shadow)
+        region.valid = false;
+}
+
+AlviumGenCP::ShadowRegion *AlviumGenCP::findShadowRegion(uint64_t addr, size_t length)
+{
+    for (auto &region : m_shadow) {
+        if (region.addr == addr && region.data.size() == length)
+            return &region;
+    }
+
+    return nullptr;
+}
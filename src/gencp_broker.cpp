@@ -0,0 +1,596 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <broker_client.h>
+#include <file_archive.h>
+#include <file_cache.h>
+#include <file_upload.h>
+#include <gencp_broker.h>
+
+#include "broker_protocol.h"
+
+namespace fs = std::filesystem;
+
+static const int ListenBacklog = 16;
+
+struct BrokerReply {
+    BrokerResponse response{};
+    std::vector<uint8_t> data;
+    std::optional<SharedBuffer> buffer;
+};
+
+struct BrokerJob {
+    int socket;             /* of the client, for progress reports */
+    BrokerRequest request;
+    std::vector<uint8_t> data;
+    std::optional<SharedBuffer> input;
+    std::promise<BrokerReply> reply;
+};
+
+static BrokerReply errorReply(int error)
+{
+    BrokerReply reply{};
+    reply.response.result = error;
+
+    return reply;
+}
+
+/*
+ * File data is received straight into the memfd handed to the client. It
+ * is sized up front if the length is known and grows otherwise, mremap
+ * moves the pages instead of copying them.
+ */
+class ContentBuffer {
+public:
+    int reserve(size_t length)
+    {
+        if (!m_buffer)
+            m_buffer = SharedBuffer::create(0);
+
+        if (!m_buffer)
+            return -ENOMEM;
+
+        return length > m_buffer->size() ? m_buffer->resize(length) : 0;
+    }
+
+    int append(const uint8_t *data, size_t length)
+    {
+        if (!m_buffer || m_used + length > m_buffer->size()) {
+            int const res = reserve(std::max(m_used + length, 2 * (m_buffer ? m_buffer->size() : 0)));
+            if (res < 0)
+                return res;
+        }
+
+        memcpy(m_buffer->data() + m_used, data, length);
+        m_used += length;
+
+        return 0;
+    }
+
+    size_t used() const
+    {
+        return m_used;
+    }
+
+    std::optional<SharedBuffer> release()
+    {
+        if (m_buffer && m_buffer->seal() < 0)
+            return std::nullopt;
+
+        return std::move(m_buffer);
+    }
+private:
+    std::optional<SharedBuffer> m_buffer;
+    size_t m_used{0};
+};
+
+/* Copy data into a new shared buffer handed to the client */
+static BrokerReply bufferReply(ssize_t result, const uint8_t *data, size_t length)
+{
+    BrokerReply reply{};
+    reply.response.result = result;
+
+    if (length == 0)
+        return reply;
+
+    reply.buffer = SharedBuffer::create(length);
+    if (!reply.buffer || reply.buffer->seal() < 0)
+        return errorReply(-ENOMEM);
+
+    memcpy(reply.buffer->data(), data, length);
+    reply.response.length = length;
+
+    return reply;
+}
+
+/* Takes a pending cancel request off the socket, a client that went away counts as one */
+static bool cancelRequested(int socket)
+{
+    BrokerRequest request{};
+
+    auto const res = ::recv(socket, &request, sizeof(request), MSG_PEEK | MSG_DONTWAIT);
+    if (res == 0)
+        return true;
+
+    if (res < ssize_t(sizeof(request)) || BrokerOp(request.op) != BrokerOp::Cancel)
+        return false;
+
+    ::recv(socket, &request, sizeof(request), MSG_DONTWAIT);
+
+    return true;
+}
+
+static std::string entryName(const BrokerRequest &request)
+{
+    return std::string(request.entry, strnlen(request.entry, sizeof(request.entry)));
+}
+
+static ssize_t readContent(AlviumGenCP &gencp, const BrokerRequest &request, ContentBuffer &buffer, bool &cached)
+{
+    auto const selector = FileSelector(request.selector);
+    auto const entry = entryName(request);
+    auto const sink = [&buffer](const uint8_t *data, size_t length) {
+        return buffer.append(data, length);
+    };
+
+    /* A cache hit arrives as one piece of the right length */
+    if (entry.empty() && (request.flags & BrokerFlagCached)) {
+        setFileCacheEnabled(true);
+        return readContentCached(gencp, selector, sink, &cached);
+    }
+
+    auto file = File::open(gencp, selector, FileOpenMode::Read);
+    if (!file)
+        return -1;
+
+    if (entry.empty()) {
+        /* Payloads are no longer than the file, only decompressed data may need more */
+        auto const fileLength = file->length();
+        if (fileLength > 0 && buffer.reserve(fileLength) < 0)
+            return -ENOMEM;
+
+        return readContent(*file, sink);
+    }
+
+    auto const index = readArchiveIndex(*file);
+    if (!index)
+        return -EINVAL;
+
+    auto const archiveEntry = index->find(entry);
+    if (!archiveEntry)
+        return -ENOENT;
+
+    if (buffer.reserve(archiveEntry->length) < 0)
+        return -ENOMEM;
+
+    return readArchiveEntry(*file, *archiveEntry, sink);
+}
+
+class Broker::CameraWorker {
+public:
+    explicit CameraWorker(AlviumGenCP session)
+        : m_session{std::move(session)}, m_thread{&CameraWorker::run, this}
+    {
+    }
+
+    ~CameraWorker()
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_stopped = true;
+        }
+
+        m_queueChanged.notify_one();
+        m_thread.join();
+    }
+
+    std::future<BrokerReply> submit(BrokerJob job)
+    {
+        auto reply = job.reply.get_future();
+
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_queue.push_back(std::move(job));
+        }
+
+        m_queueChanged.notify_one();
+
+        return reply;
+    }
+private:
+    void run()
+    {
+        for (;;) {
+            std::vector<BrokerJob> jobs;
+
+            {
+                std::unique_lock<std::mutex> lock{m_mutex};
+                m_queueChanged.wait(lock, [this] { return m_stopped || !m_queue.empty(); });
+
+                if (m_queue.empty())
+                    return;
+
+                jobs.swap(m_queue);
+            }
+
+            process(jobs);
+        }
+    }
+
+    /* Everything queued since the last round, in order */
+    void process(std::vector<BrokerJob> &jobs)
+    {
+        size_t i = 0;
+
+        while (i < jobs.size()) {
+            size_t count = 1;
+
+            while (BrokerOp(jobs[i].request.op) == BrokerOp::ReadRegister && i + count < jobs.size()
+                    && BrokerOp(jobs[i + count].request.op) == BrokerOp::ReadRegister)
+                count++;
+
+            if (count > 1)
+                readRegisterBatch(&jobs[i], count);
+            else
+                jobs[i].reply.set_value(execute(jobs[i]));
+
+            i += count;
+        }
+    }
+
+    /* Register reads of several clients go out as one readRegisters call */
+    void readRegisterBatch(BrokerJob *jobs, size_t count)
+    {
+        std::vector<BrokerReply> replies(count);
+        std::vector<RegisterRead> reads(count);
+
+        for (size_t i = 0; i < count; i++) {
+            auto const length = std::min(jobs[i].request.length, BrokerInlineLength);
+
+            replies[i].data.resize(length);
+            replies[i].response.length = length;
+            reads[i] = {jobs[i].request.addr, replies[i].data.data(), length};
+        }
+
+        if (m_session.readRegisters(reads.data(), reads.size()) < 0) {
+            /* Find out which read failed */
+            for (size_t i = 0; i < count; i++)
+                jobs[i].reply.set_value(execute(jobs[i]));
+
+            return;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            if (jobs[i].request.length > BrokerInlineLength)
+                replies[i] = errorReply(-EINVAL);
+
+            jobs[i].reply.set_value(std::move(replies[i]));
+        }
+    }
+
+    BrokerReply execute(BrokerJob &job)
+    {
+        auto &gencp = m_session;
+        auto const &request = job.request;
+
+        switch (BrokerOp(request.op)) {
+        case BrokerOp::ReadRegister: {
+            if (request.length > BrokerInlineLength)
+                return errorReply(-EINVAL);
+
+            BrokerReply reply{};
+            reply.data.resize(request.length);
+
+            reply.response.result = gencp.readRegister(request.addr, reply.data.data(), reply.data.size());
+            if (reply.response.result < 0)
+                reply.data.clear();
+
+            reply.response.length = reply.data.size();
+
+            return reply;
+        }
+        case BrokerOp::WriteRegister:
+            if (job.data.size() != request.length)
+                return errorReply(-EINVAL);
+
+            return errorReply(gencp.writeRegister(request.addr, job.data.data(), job.data.size()));
+        case BrokerOp::ReadContent: {
+            ContentBuffer buffer;
+            bool cached = false;
+
+            auto const res = readContent(gencp, request, buffer, cached);
+            if (res < 0)
+                return errorReply(res);
+
+            BrokerReply reply{};
+            reply.response.result = res;
+            reply.response.flags = cached ? uint32_t(BrokerFlagCached) : 0;
+
+            /* The memfd may be longer than the data, the client maps the length of the response */
+            if (buffer.used() > 0) {
+                reply.buffer = buffer.release();
+                if (!reply.buffer)
+                    return errorReply(-ENOMEM);
+
+                reply.response.length = buffer.used();
+            }
+
+            return reply;
+        }
+        case BrokerOp::Upload: {
+            if (request.length > 0 && !job.input)
+                return errorReply(-EINVAL);
+
+            UploadOptions options;
+            options.mode = UploadMode(request.mode);
+            options.verify = request.flags & BrokerFlagVerify;
+            options.entry = entryName(request);
+            options.resume = request.flags & BrokerFlagResume;
+
+            std::atomic<bool> cancelled{false};
+            TransferControl control;
+
+            /* Runs between chunks, while the client thread waits for the reply and does not read the socket */
+            if (request.flags & BrokerFlagProgress) {
+                control.cancelled = &cancelled;
+                control.progress = [&](const TransferProgress &progress) {
+                    BrokerResponse response{};
+                    response.result = progress.done;
+                    response.length = progress.total;
+                    response.flags = BrokerFlagProgress;
+
+                    if (sendBrokerMessage(job.socket, &response, sizeof(response), nullptr, 0) < 0
+                            || cancelRequested(job.socket))
+                        cancelled = true;
+                };
+            }
+
+            UploadResult result{};
+
+            auto const data = job.input ? job.input->data() : nullptr;
+            auto const res = uploadFile(gencp, FileSelector(request.selector), data, request.length, options, result,
+                                        control);
+
+            auto reply = errorReply(res);
+            reply.response.action = uint32_t(result.action);
+            reply.response.bytesWritten = result.bytesWritten;
+            reply.response.bytesRepaired = result.bytesRepaired;
+
+            return reply;
+        }
+        case BrokerOp::Stats: {
+            auto const stats = gencp.stats();
+
+            return bufferReply(0, reinterpret_cast<const uint8_t*>(&stats), sizeof(stats));
+        }
+        case BrokerOp::Cancel:
+            /* Only valid while an upload is running, serveClient drops it otherwise */
+            break;
+        }
+
+        return errorReply(-EINVAL);
+    }
+
+    AlviumGenCP m_session;
+
+    std::mutex m_mutex;
+    std::condition_variable m_queueChanged;
+    std::vector<BrokerJob> m_queue;
+    bool m_stopped{false};
+
+    std::thread m_thread;
+};
+
+Broker::Broker(fs::path socketPath) : m_socketPath{std::move(socketPath)}
+{
+    m_sessionFactory = [](int subdev) { return AlviumGenCP::open(subdev); };
+}
+
+Broker::~Broker()
+{
+    stop();
+
+    {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_clientsDone.wait(lock, [this] { return m_clientSockets.empty(); });
+    }
+
+    m_workers.clear();
+
+    if (m_socket >= 0)
+        ::close(m_socket);
+
+    if (m_bound) {
+        std::error_code error;
+        fs::remove(m_socketPath, error);
+    }
+}
+
+void Broker::setSessionFactory(SessionFactory factory)
+{
+    m_sessionFactory = std::move(factory);
+}
+
+int Broker::listen()
+{
+    struct sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+
+    if (m_socketPath.native().size() >= sizeof(addr.sun_path))
+        return -ENAMETOOLONG;
+
+    strcpy(addr.sun_path, m_socketPath.c_str());
+
+    std::error_code error;
+
+    if (fs::exists(m_socketPath, error)) {
+        if (BrokerClient::connect(m_socketPath))
+            return -EADDRINUSE;
+
+        /* Left behind by a broker that did not shut down */
+        fs::remove(m_socketPath, error);
+    }
+
+    fs::create_directories(m_socketPath.parent_path(), error);
+
+    m_socket = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (m_socket < 0)
+        return -errno;
+
+    if (::bind(m_socket, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0)
+        return -errno;
+
+    m_bound = true;
+
+    if (::listen(m_socket, ListenBacklog) < 0)
+        return -errno;
+
+    return 0;
+}
+
+int Broker::run()
+{
+    if (m_socket < 0)
+        return -EINVAL;
+
+    for (;;) {
+        int const client = ::accept4(m_socket, nullptr, nullptr, SOCK_CLOEXEC);
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        if (m_stopped) {
+            if (client >= 0)
+                ::close(client);
+
+            return 0;
+        }
+
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+
+            return -errno;
+        }
+
+        m_clientSockets.insert(client);
+        std::thread{&Broker::serveClient, this, client}.detach();
+    }
+}
+
+void Broker::stop()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    m_stopped = true;
+
+    /* Wakes up accept and the client threads waiting for requests */
+    if (m_socket >= 0)
+        ::shutdown(m_socket, SHUT_RDWR);
+
+    for (auto const socket : m_clientSockets)
+        ::shutdown(socket, SHUT_RDWR);
+}
+
+Broker::CameraWorker *Broker::worker(int subdev)
+{
+    /* One open at a time, so two clients never open the same camera concurrently */
+    std::lock_guard<std::mutex> openLock{m_openMutex};
+
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        auto const it = m_workers.find(subdev);
+        if (it != m_workers.end())
+            return it->second.get();
+    }
+
+    /* Outside m_mutex, the other clients go on meanwhile. No worker is kept for a missing camera */
+    auto session = m_sessionFactory(subdev);
+    if (!session)
+        return nullptr;
+
+    auto worker = std::make_unique<CameraWorker>(std::move(*session));
+    auto const result = worker.get();
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    m_workers[subdev] = std::move(worker);
+
+    return result;
+}
+
+void Broker::serveClient(int socket)
+{
+    for (;;) {
+        BrokerJob job{};
+        UniqueFd fd;
+
+        auto const res = receiveBrokerMessage(socket, &job.request, sizeof(job.request), job.data, fd);
+        if (res <= 0)
+            break;
+
+        /* Arrived after the upload it was meant for had finished */
+        if (BrokerOp(job.request.op) == BrokerOp::Cancel)
+            continue;
+
+        job.socket = socket;
+
+        BrokerReply reply{};
+        CameraWorker *cameraWorker = nullptr;
+
+        if (job.request.subdev < 0) {
+            reply = errorReply(-EINVAL);
+        } else if (fd && job.request.length > 0
+                && !(job.input = SharedBuffer::map(std::move(fd), job.request.length))) {
+            reply = errorReply(-EBADMSG);
+        } else if (!(cameraWorker = worker(job.request.subdev))) {
+            reply = errorReply(-ENODEV);
+        } else {
+            reply = cameraWorker->submit(std::move(job)).get();
+        }
+
+        auto const sent = sendBrokerMessage(socket, &reply.response, sizeof(reply.response),
+                                            reply.data.data(), reply.data.size(),
+                                            reply.buffer ? reply.buffer->fd() : -1);
+        if (sent < 0)
+            break;
+    }
+
+    ::close(socket);
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    m_clientSockets.erase(socket);
+
+    if (m_clientSockets.empty())
+        m_clientsDone.notify_all();
+}
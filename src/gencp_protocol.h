@@ -0,0 +1,91 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include <crc32.h>
+
+/* GenCP packet layout as exchanged through the Alvium mailbox */
+
+static constexpr uint16_t GenCPChannelId = 0x0;
+
+struct GenCPPrefix {
+    const uint16_t preamble{0x0100};
+    uint32_t crc;
+    const uint16_t channel_id{GenCPChannelId};
+} __attribute__((packed));
+
+/* The CRC covers channel_id first, its state after that is the same for every packet */
+static constexpr uint32_t GenCPChannelCrcState = jamcrcByte(jamcrcByte(JamcrcInit, GenCPChannelId & 0xff),
+                                                            GenCPChannelId >> 8);
+
+struct GenCPCCD {
+    union {
+        uint16_t flags;
+        uint16_t status_code;
+    };
+    uint16_t command_id;
+    uint16_t length;
+    uint16_t request_id;
+} __attribute__((packed));
+
+struct GenCPReadMemCmd {
+    uint64_t register_address;
+    uint16_t reserved;
+    uint16_t read_length;
+} __attribute__((packed));
+
+using GenCPReadMemAck = uint8_t[];
+
+struct GenCPWriteMemCmd {
+    uint64_t register_address;
+    uint8_t data[];
+} __attribute__((packed));
+
+struct GenCPWriteMemAck {
+    uint16_t reserved;
+    uint16_t length_written;
+} __attribute__((packed));
+
+struct GenCPPendingAck {
+    uint16_t reserved;
+    uint16_t timeout;
+} __attribute__((packed));
+
+
+template<typename SCD>
+struct GenCPPaket {
+    GenCPPrefix prefix;
+    GenCPCCD ccd;
+    SCD scd;
+
+    void calcCRC() {
+        auto start = reinterpret_cast<const uint8_t*>(&ccd);
+        auto const size = sizeof(ccd) + ccd.length;
+        prefix.crc = jamcrc(start, size, GenCPChannelCrcState);
+    }
+
+    /* For packets whose last dataLength bytes of scd are kept in a separate buffer */
+    void calcCRC(const uint8_t *data, size_t dataLength) {
+        auto start = reinterpret_cast<const uint8_t*>(&ccd);
+        auto const size = sizeof(ccd) + ccd.length - dataLength;
+        prefix.crc = jamcrc(data, dataLength, jamcrc(start, size, GenCPChannelCrcState));
+    }
+} __attribute__((packed));
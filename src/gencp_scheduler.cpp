@@ -0,0 +1,79 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <gencp_scheduler.h>
+
+
+bool GenCPScheduler::acquire(RequestPriority priority)
+{
+    auto const self = std::this_thread::get_id();
+
+    std::unique_lock<std::mutex> lock{m_mutex};
+
+    if (m_depth > 0 && m_owner == self) {
+        m_depth++;
+        return false;
+    }
+
+    if (priority == RequestPriority::Control) {
+        auto const start = std::chrono::steady_clock::now();
+
+        m_controlWaiting++;
+        m_released.wait(lock, [this] { return m_depth == 0; });
+        m_controlWaiting--;
+
+        std::chrono::nanoseconds const waited = std::chrono::steady_clock::now() - start;
+        m_controlWait.record(waited.count());
+    } else {
+        /* Bulk requests yield to every control request waiting at a chunk boundary */
+        m_released.wait(lock, [this] { return m_depth == 0 && m_controlWaiting == 0; });
+    }
+
+    m_owner = self;
+    m_depth = 1;
+
+    return true;
+}
+
+void GenCPScheduler::release()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        if (--m_depth > 0)
+            return;
+
+        m_owner = {};
+    }
+
+    m_released.notify_all();
+}
+
+Histogram GenCPScheduler::controlWait() const
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    return m_controlWait;
+}
+
+void GenCPScheduler::resetControlWait()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    m_controlWait = {};
+}
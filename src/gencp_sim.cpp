@@ -0,0 +1,454 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <thread>
+
+#include <cstring>
+
+#include <endian.h>
+
+#include <gencp_sim.h>
+
+#include "gencp_protocol.h"
+#include "file_access_registers.h"
+
+static const uint16_t BootstrapPointerAddr = 0x10;
+static const uint16_t MailboxBaseAddr = 0x0100;
+static const uint16_t RequestBufferAddr = 0x0200;
+static const uint16_t ResponseBufferAddr = 0x0600;
+static const uint16_t MailboxBufferLength = 0x0400;
+
+static const uint16_t RequestHandshakeAddr = MailboxBaseAddr + 0x18;
+static const uint16_t ResponseHandshakeAddr = MailboxBaseAddr + 0x1C;
+static const uint16_t RequestLengthAddr = MailboxBaseAddr + 0x20;
+static const uint16_t ResponseLengthAddr = MailboxBaseAddr + 0x24;
+
+static const uint16_t StatusSuccess = 0x0000;
+static const uint16_t StatusNotImplemented = 0x8001;
+static const uint16_t StatusInvalidParameter = 0x8002;
+static const uint16_t StatusWriteProtect = 0x8004;
+static const uint16_t StatusAccessDenied = 0x8006;
+static const uint16_t StatusInvalidHeader = 0x800E;
+
+static const uint64_t RegFileSizeTableLength = 0x100;
+
+static void putBe16(std::vector<uint8_t> &mem, uint16_t addr, uint16_t value)
+{
+    mem[addr] = value >> 8;
+    mem[addr + 1] = value & 0xff;
+}
+
+static uint16_t getBe16(const std::vector<uint8_t> &mem, uint16_t addr)
+{
+    return (uint16_t(mem[addr]) << 8) | mem[addr + 1];
+}
+
+static bool overlaps(uint64_t addr, size_t length, uint64_t regAddr, size_t regLength)
+{
+    return addr < regAddr + regLength && regAddr < addr + length;
+}
+
+
+SimulatedTransport::SimulatedTransport() : SimulatedTransport(Config{})
+{
+
+}
+
+SimulatedTransport::SimulatedTransport(const Config &config)
+    : m_config{config}, m_mailbox(0x10000), m_fileBuffer(FileAccessBufferLength)
+{
+    putBe16(m_mailbox, BootstrapPointerAddr, MailboxBaseAddr);
+    putBe16(m_mailbox, MailboxBaseAddr + 0x4, RequestBufferAddr);
+    putBe16(m_mailbox, MailboxBaseAddr + 0xC, ResponseBufferAddr);
+}
+
+void SimulatedTransport::simulateLatency(size_t length) const
+{
+    auto const latency = m_config.transactionLatency + m_config.byteLatency * length;
+
+    if (latency > std::chrono::nanoseconds::zero())
+        std::this_thread::sleep_for(latency);
+}
+
+int SimulatedTransport::readv(uint16_t addr, const struct iovec *iov, int iovCount)
+{
+    if (iovCount == 1)
+        return readMailbox(addr, static_cast<uint8_t*>(iov[0].iov_base), iov[0].iov_len);
+
+    size_t length = 0;
+    for (int i = 0; i < iovCount; i++)
+        length += iov[i].iov_len;
+
+    std::vector<uint8_t> tmp(length);
+
+    int res = readMailbox(addr, tmp.data(), length);
+    if (res < 0)
+        return res;
+
+    size_t offset = 0;
+    for (int i = 0; i < iovCount; i++) {
+        memcpy(iov[i].iov_base, &tmp[offset], iov[i].iov_len);
+        offset += iov[i].iov_len;
+    }
+
+    return 0;
+}
+
+int SimulatedTransport::writev(uint16_t addr, const struct iovec *iov, int iovCount)
+{
+    if (iovCount == 1)
+        return writeMailbox(addr, static_cast<const uint8_t*>(iov[0].iov_base), iov[0].iov_len);
+
+    std::vector<uint8_t> tmp;
+    for (int i = 0; i < iovCount; i++) {
+        auto const base = static_cast<const uint8_t*>(iov[i].iov_base);
+        tmp.insert(tmp.end(), base, base + iov[i].iov_len);
+    }
+
+    return writeMailbox(addr, tmp.data(), tmp.size());
+}
+
+int SimulatedTransport::readMailbox(uint16_t addr, uint8_t *buffer, size_t length)
+{
+    if (length > m_config.maxTransferSize || size_t(addr) + length > m_mailbox.size())
+        return -EINVAL;
+
+    simulateLatency(length);
+
+    m_transactionCount++;
+    m_bytesTransferred += length;
+
+    update();
+
+    memcpy(buffer, &m_mailbox[addr], length);
+
+    return 0;
+}
+
+int SimulatedTransport::writeMailbox(uint16_t addr, const uint8_t *buffer, size_t length)
+{
+    if (length > m_config.maxTransferSize || size_t(addr) + length > m_mailbox.size())
+        return -EINVAL;
+
+    simulateLatency(length);
+
+    m_transactionCount++;
+    m_bytesTransferred += length;
+
+    update();
+
+    auto const previousResponseHandshake = m_mailbox[ResponseHandshakeAddr];
+
+    memcpy(&m_mailbox[addr], buffer, length);
+
+    if (overlaps(addr, length, RequestHandshakeAddr, 1) && m_mailbox[RequestHandshakeAddr] == 1) {
+        m_mailbox[RequestHandshakeAddr] = 2;
+        processRequest();
+    }
+
+    if (overlaps(addr, length, ResponseHandshakeAddr, 1) && m_mailbox[ResponseHandshakeAddr] == 0
+            && previousResponseHandshake != 0) {
+        m_responsePosted = false;
+
+        if (!m_responses.empty())
+            m_responseReadyAt = std::chrono::steady_clock::now() + m_responses.front().delay;
+    }
+
+    return 0;
+}
+
+size_t SimulatedTransport::maxTransferSize() const
+{
+    return m_config.maxTransferSize;
+}
+
+void SimulatedTransport::injectPendingAcks(unsigned count, uint16_t timeoutMs, std::chrono::nanoseconds delay)
+{
+    m_pendingAcks = count;
+    m_pendingTimeout = timeoutMs;
+    m_pendingDelay = delay;
+}
+
+void SimulatedTransport::injectAckCorruption(unsigned count)
+{
+    m_corruptAcks = count;
+}
+
+void SimulatedTransport::setRegister(uint64_t addr, const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+        m_registers[addr + i] = data[i];
+}
+
+void SimulatedTransport::getRegister(uint64_t addr, uint8_t *data, size_t length) const
+{
+    for (size_t i = 0; i < length; i++) {
+        auto const it = m_registers.find(addr + i);
+        data[i] = it != m_registers.end() ? it->second : 0;
+    }
+}
+
+std::vector<uint8_t> &SimulatedTransport::file(uint32_t selector)
+{
+    return m_files[selector];
+}
+
+void SimulatedTransport::update()
+{
+    if (m_responsePosted || m_responses.empty())
+        return;
+
+    if (std::chrono::steady_clock::now() < m_responseReadyAt)
+        return;
+
+    auto const &paket = m_responses.front().paket;
+
+    memcpy(&m_mailbox[ResponseBufferAddr], paket.data(), paket.size());
+    putBe16(m_mailbox, ResponseLengthAddr, paket.size());
+    m_mailbox[ResponseHandshakeAddr] = 1;
+
+    m_responses.pop_front();
+    m_responsePosted = true;
+}
+
+void SimulatedTransport::queueAck(uint16_t status, uint16_t commandId, uint16_t requestId,
+                                  const uint8_t *scd, size_t scdLength, std::chrono::nanoseconds delay)
+{
+    std::vector<uint8_t> paket(sizeof(GenCPPrefix) + sizeof(GenCPCCD) + scdLength);
+
+    auto ack = reinterpret_cast<GenCPPaket<GenCPReadMemAck>*>(paket.data());
+    new (&ack->prefix) GenCPPrefix{};
+    ack->ccd.status_code = status;
+    ack->ccd.command_id = commandId;
+    ack->ccd.length = scdLength;
+    ack->ccd.request_id = requestId;
+    if (scdLength > 0)
+        memcpy(&ack->scd[0], scd, scdLength);
+    ack->calcCRC();
+
+    if (m_corruptAcks > 0) {
+        m_corruptAcks--;
+        paket.back() ^= 0x01;
+    }
+
+    m_responses.push_back({std::move(paket), delay});
+
+    if (m_responses.size() == 1 && !m_responsePosted)
+        m_responseReadyAt = std::chrono::steady_clock::now() + delay;
+}
+
+void SimulatedTransport::processRequest()
+{
+    m_requestCount++;
+
+    auto const length = std::min(getBe16(m_mailbox, RequestLengthAddr), MailboxBufferLength);
+    auto const cmd = reinterpret_cast<GenCPPaket<GenCPReadMemAck>*>(&m_mailbox[RequestBufferAddr]);
+
+    if (length < sizeof(GenCPPrefix) + sizeof(GenCPCCD)
+            || sizeof(GenCPPrefix) + sizeof(GenCPCCD) + cmd->ccd.length > length) {
+        queueAck(StatusInvalidHeader, 0x8001, 0, nullptr, 0, m_config.processingTime);
+        return;
+    }
+
+    auto const commandId = cmd->ccd.command_id;
+    auto const requestId = cmd->ccd.request_id;
+    auto const expectedCrc = cmd->prefix.crc;
+
+    cmd->calcCRC();
+
+    if (cmd->prefix.crc != expectedCrc) {
+        queueAck(StatusInvalidHeader, commandId + 1, requestId, nullptr, 0, m_config.processingTime);
+        return;
+    }
+
+    auto delay = m_config.processingTime;
+
+    if (m_pendingAcks > 0) {
+        m_pendingAcks--;
+
+        GenCPPendingAck pending{};
+        pending.timeout = m_pendingTimeout;
+
+        queueAck(StatusSuccess, 0x0805, requestId, reinterpret_cast<const uint8_t*>(&pending),
+                 sizeof(pending), delay);
+
+        delay = m_pendingDelay;
+    }
+
+    if (commandId == 0x0800) {
+        auto const readCmd = reinterpret_cast<const GenCPReadMemCmd*>(&cmd->scd[0]);
+        std::vector<uint8_t> data(readCmd->read_length);
+
+        auto const status = readMemory(readCmd->register_address, data.data(), data.size());
+        if (status != StatusSuccess)
+            data.clear();
+
+        queueAck(status, 0x0801, requestId, data.data(), data.size(), delay);
+    } else if (commandId == 0x0802) {
+        auto const writeCmd = reinterpret_cast<const GenCPWriteMemCmd*>(&cmd->scd[0]);
+        auto const dataLength = cmd->ccd.length - sizeof(GenCPWriteMemCmd);
+
+        GenCPWriteMemAck writeAck{};
+
+        auto const status = writeMemory(writeCmd->register_address, writeCmd->data, dataLength);
+        if (status == StatusSuccess)
+            writeAck.length_written = dataLength;
+
+        queueAck(status, 0x0803, requestId, reinterpret_cast<const uint8_t*>(&writeAck),
+                 sizeof(writeAck), delay);
+    } else {
+        queueAck(StatusNotImplemented, commandId + 1, requestId, nullptr, 0, delay);
+    }
+}
+
+uint16_t SimulatedTransport::readMemory(uint64_t addr, uint8_t *buffer, size_t length)
+{
+    if (length > m_config.maxTransferSize)
+        return StatusInvalidParameter;
+
+    FileStatus status{};
+    status.open = m_fileOpen;
+    status.readable = m_fileOpen && m_fileOpenMode == 1;
+    status.writeable = m_fileOpen && m_fileOpenMode == 2;
+    status.selector_open = m_fileSelector;
+
+    setRegister(StructFileStatusAddr, reinterpret_cast<const uint8_t*>(&status), sizeof(status));
+    setRegister(RegFileSizeMaxAddr, reinterpret_cast<const uint8_t*>(&m_config.maxFileSize), sizeof(uint32_t));
+    setRegister(RegFileAccessOffsetAddr, reinterpret_cast<const uint8_t*>(&m_fileOffset), sizeof(uint32_t));
+    setRegister(RegFileAccessLengthAddr, reinterpret_cast<const uint8_t*>(&m_fileAccessLength), sizeof(uint32_t));
+
+    for (auto const &[selector, content] : m_files) {
+        uint32_t const size = content.size();
+        setRegister(RegFileSizeBaseAddr + RegFileSizeLength * selector,
+                    reinterpret_cast<const uint8_t*>(&size), sizeof(size));
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        auto const byteAddr = addr + i;
+
+        if (overlaps(byteAddr, 1, FileAccessBufferAddr, FileAccessBufferLength)) {
+            buffer[i] = m_fileBuffer[byteAddr - FileAccessBufferAddr];
+        } else {
+            getRegister(byteAddr, &buffer[i], 1);
+        }
+    }
+
+    return StatusSuccess;
+}
+
+uint16_t SimulatedTransport::writeMemory(uint64_t addr, const uint8_t *buffer, size_t length)
+{
+    if (overlaps(addr, length, StructFileStatusAddr, StructFileStatusLength)
+            || overlaps(addr, length, RegFileSizeMaxAddr, RegFileSizeMaxLength)
+            || overlaps(addr, length, RegFileSizeBaseAddr, RegFileSizeTableLength))
+        return StatusWriteProtect;
+
+    for (size_t i = 0; i < length; i++) {
+        auto const byteAddr = addr + i;
+
+        if (overlaps(byteAddr, 1, FileAccessBufferAddr, FileAccessBufferLength)) {
+            m_fileBuffer[byteAddr - FileAccessBufferAddr] = buffer[i];
+        } else {
+            m_registers[byteAddr] = buffer[i];
+        }
+    }
+
+    if (overlaps(addr, length, RegFileAccessOffsetAddr, RegFileAccessOffsetLength))
+        getRegister(RegFileAccessOffsetAddr, reinterpret_cast<uint8_t*>(&m_fileOffset), sizeof(m_fileOffset));
+
+    if (overlaps(addr, length, RegFileAccessLengthAddr, RegFileAccessLengthLength))
+        getRegister(RegFileAccessLengthAddr, reinterpret_cast<uint8_t*>(&m_fileAccessLength), sizeof(m_fileAccessLength));
+
+    if (addr == RegFileOperationExecuteAddr && length == RegFileOperationExecuteLength) {
+        uint64_t value{};
+        memcpy(&value, buffer, sizeof(value));
+        return executeFileOperation(value);
+    }
+
+    return StatusSuccess;
+}
+
+uint16_t SimulatedTransport::executeFileOperation(uint64_t value)
+{
+    auto const operation = FileOperation(value & 0xff);
+    auto const openMode = uint8_t((value >> 16) & 0xff);
+    auto const selector = uint32_t(value >> 32);
+
+    auto const isOpenFile = m_fileOpen && m_fileSelector == selector;
+
+    switch (operation) {
+    case FileOperation::Open:
+        if (m_fileOpen || (openMode != 1 && openMode != 2))
+            return StatusAccessDenied;
+
+        m_fileOpen = true;
+        m_fileOpenMode = openMode;
+        m_fileSelector = selector;
+        m_fileOffset = 0;
+        m_files[selector];
+        return StatusSuccess;
+
+    case FileOperation::Close:
+        if (!isOpenFile)
+            return StatusAccessDenied;
+
+        m_fileOpen = false;
+        m_fileOpenMode = 0;
+        return StatusSuccess;
+
+    case FileOperation::Read: {
+        if (!isOpenFile || m_fileOpenMode != 1)
+            return StatusAccessDenied;
+
+        auto const &content = m_files[selector];
+        auto const available = m_fileOffset < content.size() ? content.size() - m_fileOffset : 0;
+        auto const count = std::min<size_t>({m_fileAccessLength, available, FileAccessBufferLength});
+
+        memcpy(m_fileBuffer.data(), content.data() + m_fileOffset, count);
+        m_fileOffset += count;
+        return StatusSuccess;
+    }
+
+    case FileOperation::Write: {
+        if (!isOpenFile || m_fileOpenMode != 2)
+            return StatusAccessDenied;
+
+        auto const count = std::min<size_t>(m_fileAccessLength, FileAccessBufferLength);
+        if (m_fileOffset + count > m_config.maxFileSize)
+            return StatusInvalidParameter;
+
+        auto &content = m_files[selector];
+        if (content.size() < m_fileOffset + count)
+            content.resize(m_fileOffset + count);
+
+        memcpy(content.data() + m_fileOffset, m_fileBuffer.data(), count);
+        m_fileOffset += count;
+        return StatusSuccess;
+    }
+
+    case FileOperation::Delete:
+        if (isOpenFile)
+            return StatusAccessDenied;
+
+        m_files[selector].clear();
+        return StatusSuccess;
+    }
+
+    return StatusInvalidParameter;
+}
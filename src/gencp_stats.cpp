@@ -0,0 +1,227 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies Gmbh
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <unistd.h>
+
+#include <gencp_stats.h>
+#include <gencp_trace.h>
+
+
+/* Indexed by FileOperation */
+static const char *const fileOperationNames[FileOperationCount] = {
+    "open", "close", "read", "write", "delete",
+};
+
+/* Bucket bounds exported to Prometheus, 1us to 16s and 1 to 64Ki */
+static const unsigned LatencyExponentMin = 10;
+static const unsigned LatencyExponentMax = 34;
+static const unsigned CountExponentMin = 0;
+static const unsigned CountExponentMax = 16;
+
+
+void Histogram::record(uint64_t value)
+{
+    unsigned bucket = 0;
+
+    while (bucket < BucketCount - 1 && value > (uint64_t(1) << bucket))
+        bucket++;
+
+    m_buckets[bucket]++;
+    m_count++;
+    m_sum += value;
+}
+
+uint64_t Histogram::count() const
+{
+    return m_count;
+}
+
+uint64_t Histogram::sum() const
+{
+    return m_sum;
+}
+
+uint64_t Histogram::countUpTo(unsigned exponent) const
+{
+    uint64_t count = 0;
+
+    for (unsigned i = 0; i <= exponent && i < BucketCount; i++)
+        count += m_buckets[i];
+
+    return count;
+}
+
+static void formatHistogram(std::ostream &stream, const char *name, const Histogram &histogram, const char *unit)
+{
+    if (histogram.count() == 0)
+        return;
+
+    stream << std::left << std::setw(24) << name
+           << " count " << std::setw(8) << histogram.count()
+           << " avg " << histogram.sum() / histogram.count() << unit << std::endl;
+}
+
+std::string formatStats(const GenCPStats &stats)
+{
+    std::ostringstream stream;
+
+    stream << "packets sent            " << stats.packetsSent << " (" << stats.bytesSent << " bytes)" << std::endl
+           << "packets received        " << stats.packetsReceived << " (" << stats.bytesReceived << " bytes)" << std::endl
+           << "pending acks            " << stats.pendingAcks << std::endl
+           << "ack crc errors          " << stats.ackCrcErrors << std::endl
+           << "shadow hits             " << stats.shadowHits << std::endl;
+
+    formatHistogram(stream, "handshake polls/packet", stats.handshakePolls, "");
+    formatHistogram(stream, "pending ack wait", stats.pendingAckWait, " ns");
+    formatHistogram(stream, "control wait", stats.controlWait, " ns");
+    formatHistogram(stream, "readRegister", stats.readRegisterLatency, " ns");
+    formatHistogram(stream, "writeRegister", stats.writeRegisterLatency, " ns");
+    formatHistogram(stream, "readRegister bytes", stats.readRegisterBytes, "");
+    formatHistogram(stream, "writeRegister bytes", stats.writeRegisterBytes, "");
+
+    for (size_t i = 0; i < FileOperationCount; i++) {
+        auto const name = std::string{"file "} + fileOperationNames[i];
+        formatHistogram(stream, name.c_str(), stats.fileOperationLatency[i], " ns");
+    }
+
+    return stream.str();
+}
+
+static std::string joinLabels(const std::string &labels, const std::string &extra)
+{
+    if (labels.empty() || extra.empty())
+        return labels + extra;
+
+    return labels + "," + extra;
+}
+
+static void prometheusCounter(std::ostream &stream, const std::string &name, uint64_t value,
+                              const std::string &labels)
+{
+    stream << "# TYPE " << name << " counter" << std::endl
+           << name << "{" << labels << "} " << value << std::endl;
+}
+
+/* scale converts the recorded unit into the exported one, e.g. 1e-9 for nanoseconds to seconds */
+static void prometheusHistogram(std::ostream &stream, const std::string &name, const Histogram &histogram,
+                                const std::string &labels, unsigned exponentMin, unsigned exponentMax,
+                                double scale, bool typeLine = true)
+{
+    if (typeLine)
+        stream << "# TYPE " << name << " histogram" << std::endl;
+
+    for (unsigned exponent = exponentMin; exponent <= exponentMax; exponent++) {
+        std::ostringstream le;
+        le << (uint64_t(1) << exponent) * scale;
+
+        stream << name << "_bucket{" << joinLabels(labels, "le=\"" + le.str() + "\"") << "} "
+               << histogram.countUpTo(exponent) << std::endl;
+    }
+
+    stream << name << "_bucket{" << joinLabels(labels, "le=\"+Inf\"") << "} " << histogram.count() << std::endl
+           << name << "_sum{" << labels << "} " << histogram.sum() * scale << std::endl
+           << name << "_count{" << labels << "} " << histogram.count() << std::endl;
+}
+
+std::string formatPrometheus(const GenCPStats &stats, const std::string &labels)
+{
+    std::ostringstream stream;
+
+    prometheusCounter(stream, "alvium_gencp_packets_sent_total", stats.packetsSent, labels);
+    prometheusCounter(stream, "alvium_gencp_packets_received_total", stats.packetsReceived, labels);
+    prometheusCounter(stream, "alvium_gencp_sent_bytes_total", stats.bytesSent, labels);
+    prometheusCounter(stream, "alvium_gencp_received_bytes_total", stats.bytesReceived, labels);
+    prometheusCounter(stream, "alvium_gencp_pending_acks_total", stats.pendingAcks, labels);
+    prometheusCounter(stream, "alvium_gencp_ack_crc_errors_total", stats.ackCrcErrors, labels);
+    prometheusCounter(stream, "alvium_gencp_shadow_hits_total", stats.shadowHits, labels);
+
+    prometheusHistogram(stream, "alvium_gencp_handshake_polls", stats.handshakePolls, labels,
+                        CountExponentMin, CountExponentMax, 1);
+    prometheusHistogram(stream, "alvium_gencp_pending_ack_wait_seconds", stats.pendingAckWait, labels,
+                        LatencyExponentMin, LatencyExponentMax, 1e-9);
+    prometheusHistogram(stream, "alvium_gencp_control_wait_seconds", stats.controlWait, labels,
+                        LatencyExponentMin, LatencyExponentMax, 1e-9);
+    prometheusHistogram(stream, "alvium_gencp_read_register_seconds", stats.readRegisterLatency, labels,
+                        LatencyExponentMin, LatencyExponentMax, 1e-9);
+    prometheusHistogram(stream, "alvium_gencp_write_register_seconds", stats.writeRegisterLatency, labels,
+                        LatencyExponentMin, LatencyExponentMax, 1e-9);
+    prometheusHistogram(stream, "alvium_gencp_read_register_bytes", stats.readRegisterBytes, labels,
+                        CountExponentMin, CountExponentMax, 1);
+    prometheusHistogram(stream, "alvium_gencp_write_register_bytes", stats.writeRegisterBytes, labels,
+                        CountExponentMin, CountExponentMax, 1);
+
+    stream << "# TYPE alvium_file_operation_seconds histogram" << std::endl;
+
+    for (size_t i = 0; i < FileOperationCount; i++) {
+        auto const operationLabels = joinLabels(labels, std::string{"operation=\""} + fileOperationNames[i] + "\"");
+
+        prometheusHistogram(stream, "alvium_file_operation_seconds", stats.fileOperationLatency[i], operationLabels,
+                            LatencyExponentMin, LatencyExponentMax, 1e-9, false);
+    }
+
+    return stream.str();
+}
+
+int writePrometheusFile(const std::filesystem::path &path, const GenCPStats &stats, const std::string &labels)
+{
+    auto tmpPath = path;
+    tmpPath += "." + std::to_string(::getpid());
+
+    {
+        std::ofstream stream{tmpPath};
+        stream << formatPrometheus(stats, labels);
+
+        if (!stream)
+            return -1;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tmpPath, path, error);
+
+    if (error) {
+        std::filesystem::remove(tmpPath, error);
+        return -1;
+    }
+
+    return 0;
+}
+
+int reportStats(const GenCPStats &stats, int subdev, bool printStats, const std::filesystem::path &prometheusFile,
+                const TraceRecorder *trace, const std::filesystem::path &traceFile)
+{
+    if (printStats)
+        std::cerr << formatStats(stats);
+
+    if (!prometheusFile.empty()
+            && writePrometheusFile(prometheusFile, stats, "subdev=\"" + std::to_string(subdev) + "\"") < 0) {
+        std::cerr << "Failed to write " << prometheusFile.string() << std::endl;
+        return -1;
+    }
+
+    if (trace && !traceFile.empty() && trace->writeChromeTrace(traceFile) < 0) {
+        std::cerr << "Failed to write " << traceFile.string() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
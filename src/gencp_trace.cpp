@@ -0,0 +1,118 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies Gmbh
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+#include <gencp_trace.h>
+
+
+static const char *const eventNames[] = {
+    "writePaket", "readPaket", "handshake", "pendingAck", "rawRead", "rawWrite",
+};
+
+
+TraceRecorder::TraceRecorder(size_t capacity) : m_events(std::max<size_t>(capacity, 1))
+{
+
+}
+
+void TraceRecorder::record(TraceEventType type, int subdev, std::chrono::steady_clock::time_point start,
+                           std::chrono::steady_clock::time_point end, uint16_t addr, size_t length, int32_t arg)
+{
+    auto const index = m_next.fetch_add(1, std::memory_order_relaxed) % m_events.size();
+    auto const duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+    auto &event = m_events[index];
+    event.start = std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count();
+    event.duration = std::min<int64_t>(duration, UINT32_MAX);
+    event.addr = addr;
+    event.length = std::min<size_t>(length, UINT16_MAX);
+    event.arg = arg;
+    event.subdev = subdev;
+    event.type = type;
+}
+
+std::vector<TraceEvent> TraceRecorder::events() const
+{
+    auto const next = m_next.load();
+    auto const count = std::min(next, m_events.size());
+
+    std::vector<TraceEvent> events;
+    events.reserve(count);
+
+    for (size_t i = next - count; i < next; i++)
+        events.push_back(m_events[i % m_events.size()]);
+
+    return events;
+}
+
+size_t TraceRecorder::dropped() const
+{
+    auto const next = m_next.load();
+
+    return next > m_events.size() ? next - m_events.size() : 0;
+}
+
+void TraceRecorder::clear()
+{
+    m_next = 0;
+}
+
+int TraceRecorder::writeChromeTrace(const std::filesystem::path &path) const
+{
+    std::ofstream stream{path};
+    if (!stream)
+        return -1;
+
+    auto const events = this->events();
+    int64_t origin = INT64_MAX;
+
+    for (auto const &event : events)
+        origin = std::min(origin, event.start);
+
+    /* Nanosecond resolution however long the trace is, not 6 significant digits */
+    stream << std::fixed << std::setprecision(3);
+
+    stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    bool first = true;
+
+    for (auto const &event : events) {
+        auto const typeIndex = size_t(event.type);
+        if (typeIndex >= std::size(eventNames))
+            continue;
+
+        /* Timestamps are in microseconds, relative to the first event */
+        stream << (first ? "\n" : ",\n")
+               << "{\"name\":\"" << eventNames[typeIndex] << "\",\"cat\":\"gencp\",\"ph\":\"X\""
+               << ",\"ts\":" << (event.start - origin) / 1000.0
+               << ",\"dur\":" << event.duration / 1000.0
+               << ",\"pid\":1,\"tid\":" << event.subdev
+               << ",\"args\":{\"addr\":" << event.addr
+               << ",\"length\":" << event.length
+               << ",\"arg\":" << event.arg << "}}";
+
+        first = false;
+    }
+
+    stream << "\n]}\n";
+
+    return stream ? 0 : -1;
+}
@@ -0,0 +1,157 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <gencp_transport.h>
+
+struct avt3_fw_transfer {
+    __u16 addr;
+    __u16 len;
+    __u8  rd;
+    __u8  reserved[3];
+} __attribute__((packed));
+
+
+std::unique_ptr<SysfsTransport> SysfsTransport::open(const std::filesystem::path &fwTransferPath)
+{
+    auto const fd = ::open(fwTransferPath.c_str(), O_RDWR);
+
+    if (fd < 0)
+        return nullptr;
+
+    /* The attribute size is the header plus the largest payload */
+    struct stat stat{};
+
+    if (::fstat(fd, &stat) < 0 || size_t(stat.st_size) <= sizeof(avt3_fw_transfer)) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    return std::unique_ptr<SysfsTransport>{new SysfsTransport(fd, stat.st_size)};
+}
+
+SysfsTransport::SysfsTransport(int fd, size_t attributeSize) : m_fd{fd}, m_staging(attributeSize)
+{
+
+}
+
+SysfsTransport::~SysfsTransport()
+{
+    ::close(m_fd);
+}
+
+static size_t iovLength(const struct iovec *iov, int iovCount)
+{
+    size_t length = 0;
+
+    for (int i = 0; i < iovCount; i++)
+        length += iov[i].iov_len;
+
+    return length;
+}
+
+int SysfsTransport::readv(uint16_t addr, const struct iovec *iov, int iovCount)
+{
+    if (iovCount > MaxIovCount)
+        return -EINVAL;
+
+    auto const length = iovLength(iov, iovCount);
+    if (length > maxTransferSize())
+        return -EINVAL;
+
+    avt3_fw_transfer xfer{};
+    xfer.addr = addr;
+    xfer.len = length;
+    xfer.rd = true;
+
+    auto res = ::pwrite(m_fd, &xfer, sizeof(xfer), 0);
+    if (res < 0)
+        return -errno;
+
+    if (size_t(res) != sizeof(xfer))
+        return -EIO;
+
+    auto const data = iovCount == 1 ? static_cast<uint8_t*>(iov[0].iov_base) : m_staging.data();
+
+    res = ::pread(m_fd, data, length, 0);
+    if (res < 0)
+        return -errno;
+
+    if (size_t(res) != length)
+        return -EIO;
+
+    if (iovCount > 1) {
+        size_t offset = 0;
+
+        for (int i = 0; i < iovCount; i++) {
+            memcpy(iov[i].iov_base, data + offset, iov[i].iov_len);
+            offset += iov[i].iov_len;
+        }
+    }
+
+    return 0;
+}
+
+int SysfsTransport::writev(uint16_t addr, const struct iovec *iov, int iovCount)
+{
+    if (iovCount > MaxIovCount)
+        return -EINVAL;
+
+    auto const length = iovLength(iov, iovCount);
+    if (length > maxTransferSize())
+        return -EINVAL;
+
+    avt3_fw_transfer xfer{};
+    xfer.addr = addr;
+    xfer.len = length;
+    xfer.rd = false;
+
+    /* The header goes in front of the payload within the same write */
+    memcpy(m_staging.data(), &xfer, sizeof(xfer));
+
+    size_t offset = sizeof(xfer);
+
+    for (int i = 0; i < iovCount; i++) {
+        memcpy(m_staging.data() + offset, iov[i].iov_base, iov[i].iov_len);
+        offset += iov[i].iov_len;
+    }
+
+    auto const res = ::pwrite(m_fd, m_staging.data(), offset, 0);
+    if (res < 0)
+        return -errno;
+
+    if (size_t(res) != offset)
+        return -EIO;
+
+    return 0;
+}
+
+size_t SysfsTransport::maxTransferSize() const
+{
+    return m_staging.size() - sizeof(avt3_fw_transfer);
+}
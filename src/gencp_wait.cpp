@@ -0,0 +1,70 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+
+#include <gencp_wait.h>
+
+
+void AdaptiveWaitStrategy::begin(HandshakeStage stage, Duration hint)
+{
+    m_stage = stage;
+    m_hint = hint;
+    m_delay = Duration::zero();
+    m_polls = 0;
+}
+
+GenCPWaitStrategy::Duration AdaptiveWaitStrategy::nextDelay()
+{
+    m_polls++;
+
+    if (m_polls <= m_config.spinPolls)
+        return Duration::zero();
+
+    if (m_delay == Duration::zero()) {
+        m_delay = estimate(m_stage) / 2;
+    } else {
+        m_delay *= 2;
+    }
+
+    auto maxDelay = m_config.maxDelay;
+
+    /* The device announced a turnaround, re-poll well before it expires */
+    if (m_hint > Duration::zero())
+        maxDelay = std::max(m_config.minDelay, std::min(maxDelay, m_hint / 4));
+
+    m_delay = std::clamp(m_delay, m_config.minDelay, maxDelay);
+
+    return m_delay;
+}
+
+void AdaptiveWaitStrategy::complete(HandshakeStage stage, Duration elapsed)
+{
+    auto &estimate = m_estimate[size_t(stage)];
+
+    if (estimate == Duration::zero()) {
+        estimate = elapsed;
+    } else {
+        estimate += (elapsed - estimate) / (1 << m_config.learningShift);
+    }
+}
+
+GenCPWaitStrategy::Duration AdaptiveWaitStrategy::estimate(HandshakeStage stage) const
+{
+    return m_estimate[size_t(stage)];
+}
@@ -0,0 +1,181 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies Gmbh
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <array>
+
+#include <cstring>
+
+#include <sys/types.h>
+
+#include "lz_codec.h"
+
+
+static const size_t MinMatch = 4;
+static const unsigned HashBits = 12;
+/* Matches never extend into the tail, so the last sequence always carries literals */
+static const size_t TailLiterals = 5;
+
+static uint32_t read32(const uint8_t *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t hash(uint32_t value)
+{
+    return (value * 2654435761u) >> (32 - HashBits);
+}
+
+static uint8_t *writeLength(uint8_t *out, size_t length)
+{
+    while (length >= 255) {
+        *out++ = 255;
+        length -= 255;
+    }
+
+    *out++ = length;
+
+    return out;
+}
+
+static uint8_t *writeLiterals(uint8_t *out, const uint8_t *literals, size_t count, uint8_t matchNibble)
+{
+    *out++ = (count >= 15 ? 15 : count) << 4 | matchNibble;
+
+    if (count >= 15)
+        out = writeLength(out, count - 15);
+
+    memcpy(out, literals, count);
+
+    return out + count;
+}
+
+size_t lzCompress(const uint8_t *in, size_t length, uint8_t *out)
+{
+    std::array<uint16_t, 1 << HashBits> table{};
+
+    auto const start = out;
+    size_t anchor = 0;
+    size_t pos = 1;
+
+    if (length > MinMatch + TailLiterals) {
+        auto const matchLimit = length - TailLiterals;
+
+        table[hash(read32(in))] = 0;
+
+        while (pos + MinMatch <= matchLimit) {
+            auto const value = read32(in + pos);
+            auto &entry = table[hash(value)];
+            size_t const candidate = entry;
+            entry = pos;
+
+            if (candidate >= pos || pos - candidate > UINT16_MAX || read32(in + candidate) != value) {
+                pos++;
+                continue;
+            }
+
+            size_t matchLength = MinMatch;
+            while (pos + matchLength < matchLimit && in[candidate + matchLength] == in[pos + matchLength])
+                matchLength++;
+
+            auto const code = matchLength - MinMatch;
+
+            out = writeLiterals(out, in + anchor, pos - anchor, code >= 15 ? 15 : code);
+
+            uint16_t const offset = pos - candidate;
+            *out++ = offset & 0xff;
+            *out++ = offset >> 8;
+
+            if (code >= 15)
+                out = writeLength(out, code - 15);
+
+            pos += matchLength;
+            anchor = pos;
+        }
+    }
+
+    out = writeLiterals(out, in + anchor, length - anchor, 0);
+
+    return out - start;
+}
+
+/* Reads a length extension, returns false if in runs out */
+static bool readLength(const uint8_t *&in, const uint8_t *end, size_t &length)
+{
+    uint8_t byte;
+
+    do {
+        if (in == end)
+            return false;
+
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+
+    return true;
+}
+
+ssize_t lzDecompress(const uint8_t *in, size_t length, uint8_t *out, size_t outCapacity)
+{
+    auto const end = in + length;
+    size_t produced = 0;
+
+    while (in < end) {
+        auto const token = *in++;
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !readLength(in, end, literals))
+            return -1;
+
+        if (literals > size_t(end - in) || literals > outCapacity - produced)
+            return -1;
+
+        memcpy(out + produced, in, literals);
+        in += literals;
+        produced += literals;
+
+        /* The last sequence has no match */
+        if (in == end)
+            break;
+
+        if (end - in < 2)
+            return -1;
+
+        size_t const offset = in[0] | in[1] << 8;
+        in += 2;
+
+        size_t matchLength = token & 0xf;
+        if (matchLength == 15 && !readLength(in, end, matchLength))
+            return -1;
+
+        matchLength += MinMatch;
+
+        if (offset == 0 || offset > produced || matchLength > outCapacity - produced)
+            return -1;
+
+        /* Byte by byte, the match may overlap what it produces */
+        auto const source = out + produced - offset;
+        for (size_t i = 0; i < matchLength; i++)
+            out[produced + i] = source[i];
+
+        produced += matchLength;
+    }
+
+    return produced;
+}
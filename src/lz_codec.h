@@ -0,0 +1,46 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies Gmbh
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <sys/types.h>
+
+/*
+ * Byte oriented LZ77 codec in the style of LZ4. A block is a series of
+ * sequences, each a token (literal count << 4 | match length - 4),
+ * optional length extension bytes of 255, the literals, a 16 bit little
+ * endian match offset and match length extension bytes. The last
+ * sequence has literals only and ends the block. Blocks are independent
+ * and at most 64 KiB.
+ */
+static constexpr size_t LzMaxBlockSize = 0x10000;
+
+/* Worst case compressed size of length bytes */
+constexpr size_t lzCompressBound(size_t length)
+{
+    return length + length / 255 + 16;
+}
+
+/* Returns the compressed size, out has to hold lzCompressBound(length) bytes */
+size_t lzCompress(const uint8_t *in, size_t length, uint8_t *out);
+
+/* Returns the decompressed size or -1 if in is corrupt or does not fit outCapacity */
+ssize_t lzDecompress(const uint8_t *in, size_t length, uint8_t *out, size_t outCapacity);
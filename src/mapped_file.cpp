@@ -0,0 +1,100 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <mapped_file.h>
+
+
+std::optional<MappedFile> MappedFile::openRead(const std::filesystem::path &path)
+{
+    auto const fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return std::nullopt;
+
+    struct stat stat{};
+
+    if (fstat(fd, &stat) < 0) {
+        ::close(fd);
+        return std::nullopt;
+    }
+
+    size_t const size = stat.st_size;
+
+    if (size == 0) {
+        ::close(fd);
+        return MappedFile{nullptr, 0};
+    }
+
+    auto const data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+        return std::nullopt;
+
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    return MappedFile{static_cast<uint8_t*>(data), size};
+}
+
+std::optional<MappedFile> MappedFile::create(const std::filesystem::path &path, size_t length)
+{
+    auto const fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return std::nullopt;
+
+    if (length == 0) {
+        ::close(fd);
+        return MappedFile{nullptr, 0};
+    }
+
+    /* Stores into holes of a sparse file raise SIGBUS once the filesystem is full, fail here instead */
+    if (posix_fallocate(fd, 0, length) != 0) {
+        ::close(fd);
+        return std::nullopt;
+    }
+
+    auto const data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+        return std::nullopt;
+
+    return MappedFile{static_cast<uint8_t*>(data), length};
+}
+
+MappedFile::MappedFile(uint8_t *data, size_t size) : m_data{data}, m_size{size}
+{
+
+}
+
+MappedFile::MappedFile(MappedFile &&other) : m_data{other.m_data}, m_size{other.m_size}
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data)
+        munmap(m_data, m_size);
+}
@@ -0,0 +1,263 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies Gmbh
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <cctype>
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include <camera_discovery.h>
+#include <crc32.h>
+
+#include "session_cache.h"
+
+namespace fs = std::filesystem;
+
+static const char *const DefaultCacheDir = "/var/cache/alvium_file_access";
+static const char *const CachedFilePrefix = "file_";
+static const char *const JournalPrefix = "journal_";
+
+static const uint32_t CachedFileMagic = 0x43555641; /* "AVUC" */
+
+struct CachedFileHeader {
+    uint32_t magic;
+    uint32_t fileLength;
+    uint32_t headLength;
+    uint32_t dataLength;
+    uint32_t crc;       /* over head and data */
+} __attribute__((packed));
+
+
+std::optional<fs::path> hostCacheDir()
+{
+    auto const env = std::getenv("ALVIUM_CACHE_DIR");
+    fs::path const dir{env ? env : DefaultCacheDir};
+
+    if (dir.empty())
+        return std::nullopt;
+
+    return dir;
+}
+
+/* Only called to store an entry, so reading never creates the directory */
+static bool createEntryDir(const fs::path &path)
+{
+    auto const dir = path.parent_path();
+
+    std::error_code error;
+    fs::create_directories(dir, error);
+
+    return !error && ::access(dir.c_str(), W_OK) == 0;
+}
+
+/* Entries are written to a temporary file first, so concurrent opens never see a partial entry */
+static void replaceEntry(const fs::path &tmpPath, const fs::path &path)
+{
+    std::error_code error;
+    fs::rename(tmpPath, path, error);
+
+    if (error)
+        fs::remove(tmpPath, error);
+}
+
+/* Unique per process and call, threads of one process store entries concurrently too */
+static fs::path tmpEntryPath(const fs::path &path)
+{
+    static std::atomic<unsigned> counter{0};
+
+    auto tmpPath = path;
+    tmpPath += "." + std::to_string(::getpid()) + "." + std::to_string(counter.fetch_add(1));
+
+    return tmpPath;
+}
+
+std::optional<std::string> cameraFileKey(AlviumGenCP &gencp, FileSelector selector)
+{
+    auto const serial = readSerialNumber(gencp);
+    if (!serial || serial->empty())
+        return std::nullopt;
+
+    std::ostringstream key;
+    key << *serial << "-" << std::hex << uint32_t(selector);
+
+    return key.str();
+}
+
+static std::optional<fs::path> keyedEntryPath(const char *prefix, const std::string &key)
+{
+    auto dir = hostCacheDir();
+    if (!dir)
+        return std::nullopt;
+
+    auto name = key;
+    std::replace_if(name.begin(), name.end(), [](char c) { return !std::isalnum(uint8_t(c)) && c != '-'; }, '_');
+
+    return *dir / (prefix + name);
+}
+
+static std::optional<fs::path> cachedFilePath(const std::string &key)
+{
+    return keyedEntryPath(CachedFilePrefix, key);
+}
+
+std::optional<CachedFile> loadCachedFile(const std::string &key)
+{
+    auto const path = cachedFilePath(key);
+    if (!path)
+        return std::nullopt;
+
+    std::ifstream stream{*path, std::ios::binary};
+    CachedFileHeader header{};
+
+    if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != CachedFileMagic)
+        return std::nullopt;
+
+    CachedFile file{header.fileLength, {}, {}};
+    file.head.resize(header.headLength);
+    file.data.resize(header.dataLength);
+
+    stream.read(reinterpret_cast<char*>(file.head.data()), file.head.size());
+    stream.read(reinterpret_cast<char*>(file.data.data()), file.data.size());
+
+    if (!stream)
+        return std::nullopt;
+
+    /* Guards against a damaged cache, not against changes on the camera */
+    auto const crc = crc32(file.data.data(), file.data.size(), crc32(file.head.data(), file.head.size()));
+    if (crc != header.crc)
+        return std::nullopt;
+
+    return file;
+}
+
+void storeCachedFile(const std::string &key, const CachedFile &file)
+{
+    auto const path = cachedFilePath(key);
+    if (!path || !createEntryDir(*path))
+        return;
+
+    CachedFileHeader header{};
+    header.magic = CachedFileMagic;
+    header.fileLength = file.fileLength;
+    header.headLength = file.head.size();
+    header.dataLength = file.data.size();
+    header.crc = crc32(file.data.data(), file.data.size(), crc32(file.head.data(), file.head.size()));
+
+    auto const tmpPath = tmpEntryPath(*path);
+
+    {
+        std::ofstream stream{tmpPath, std::ios::binary};
+
+        stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        stream.write(reinterpret_cast<const char*>(file.head.data()), file.head.size());
+        stream.write(reinterpret_cast<const char*>(file.data.data()), file.data.size());
+
+        if (!stream)
+            return;
+    }
+
+    replaceEntry(tmpPath, *path);
+}
+
+void removeCachedFile(const std::string &key)
+{
+    auto const path = cachedFilePath(key);
+    if (!path)
+        return;
+
+    std::error_code error;
+    fs::remove(*path, error);
+}
+
+bool hasCachedFiles()
+{
+    auto const dir = hostCacheDir();
+    if (!dir)
+        return false;
+
+    std::error_code error;
+
+    for (auto const &entry : fs::directory_iterator{*dir, error})
+        if (entry.path().filename().string().rfind(CachedFilePrefix, 0) == 0)
+            return true;
+
+    return false;
+}
+
+std::optional<TransferJournal> loadTransferJournal(const std::string &key)
+{
+    auto const path = keyedEntryPath(JournalPrefix, key);
+    if (!path)
+        return std::nullopt;
+
+    std::ifstream stream{*path};
+    TransferJournal journal{};
+
+    stream >> std::hex >> journal.offset >> journal.length >> journal.sourceCrc
+           >> journal.confirmed >> journal.confirmedCrc;
+
+    if (!stream || journal.confirmed > journal.length)
+        return std::nullopt;
+
+    /* Empty for uploads */
+    stream >> std::ws;
+    std::getline(stream, journal.target);
+
+    return journal;
+}
+
+void storeTransferJournal(const std::string &key, const TransferJournal &journal)
+{
+    auto const path = keyedEntryPath(JournalPrefix, key);
+    if (!path || !createEntryDir(*path))
+        return;
+
+    auto const tmpPath = tmpEntryPath(*path);
+
+    {
+        std::ofstream stream{tmpPath};
+
+        stream << std::hex << journal.offset << std::endl
+               << journal.length << std::endl
+               << journal.sourceCrc << std::endl
+               << journal.confirmed << std::endl
+               << journal.confirmedCrc << std::endl
+               << journal.target << std::endl;
+
+        if (!stream)
+            return;
+    }
+
+    replaceEntry(tmpPath, *path);
+}
+
+void removeTransferJournal(const std::string &key)
+{
+    auto const path = keyedEntryPath(JournalPrefix, key);
+    if (!path)
+        return;
+
+    std::error_code error;
+    fs::remove(*path, error);
+}
@@ -0,0 +1,69 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies Gmbh
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+#include <file_access.h>
+
+/*
+ * Host side cache of camera file data and transfer journals, kept
+ * in ALVIUM_CACHE_DIR (default /var/cache/alvium_file_access). An empty
+ * ALVIUM_CACHE_DIR disables it, the directory is only created to store
+ * an entry. Callers have to validate an entry before trusting it.
+ */
+std::optional<std::filesystem::path> hostCacheDir();
+
+/* Identifies a file of one camera by its serial number, std::nullopt if it has none */
+std::optional<std::string> cameraFileKey(AlviumGenCP &gencp, FileSelector selector);
+
+/*
+ * Decoded contents of a camera file together with the length and first
+ * bytes of the file they were read from, which validate the entry.
+ */
+struct CachedFile {
+    uint32_t fileLength;
+    std::vector<uint8_t> head;
+    std::vector<uint8_t> data;
+};
+
+std::optional<CachedFile> loadCachedFile(const std::string &key);
+void storeCachedFile(const std::string &key, const CachedFile &file);
+void removeCachedFile(const std::string &key);
+/* Cheap check whether there is anything to invalidate at all */
+bool hasCachedFiles();
+
+/* Progress of an interrupted resumable transfer, see file_resume.h */
+struct TransferJournal {
+    uint32_t offset;        /* first byte of the range in the camera file */
+    uint32_t length;        /* of the whole transfer */
+    uint32_t sourceCrc;     /* identifies the data the transfer is about */
+    uint32_t confirmed;     /* bytes known to have arrived */
+    uint32_t confirmedCrc;  /* crc32() of the confirmed bytes */
+    std::string target;     /* host file of a download */
+};
+
+std::optional<TransferJournal> loadTransferJournal(const std::string &key);
+void storeTransferJournal(const std::string &key, const TransferJournal &journal);
+void removeTransferJournal(const std::string &key);
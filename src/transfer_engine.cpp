@@ -0,0 +1,205 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies Gmbh
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include <cerrno>
+
+#include <file_content.h>
+#include <file_upload.h>
+#include <transfer_engine.h>
+
+
+TransferEngine::TransferEngine(unsigned maxWorkers)
+    : m_maxWorkers{maxWorkers != 0 ? maxWorkers : std::max(1U, std::thread::hardware_concurrency())},
+      m_sessionFactory{[](int subdev) { return AlviumGenCP::open(subdev); }}
+{
+
+}
+
+void TransferEngine::setProgressCallback(ProgressCallback callback)
+{
+    m_progressCallback = std::move(callback);
+}
+
+void TransferEngine::setSessionFactory(SessionFactory factory)
+{
+    m_sessionFactory = std::move(factory);
+}
+
+void TransferEngine::setBrokerSocket(std::filesystem::path socketPath)
+{
+    m_brokerSocket = std::move(socketPath);
+}
+
+void TransferEngine::reportProgress(int subdev, size_t done, size_t total)
+{
+    if (!m_progressCallback)
+        return;
+
+    std::lock_guard<std::mutex> lock{m_progressMutex};
+
+    m_progressCallback(subdev, done, total);
+}
+
+std::vector<CameraResult> TransferEngine::run(const std::vector<int> &subdevs, const Operation &operation)
+{
+    return runTasks(subdevs, [&](int subdev, const Progress &progress) -> ssize_t {
+        auto gencp = m_sessionFactory(subdev);
+        if (!gencp)
+            return -1;
+
+        return operation(*gencp, subdev, progress);
+    });
+}
+
+std::vector<CameraResult> TransferEngine::runBrokered(const std::vector<int> &subdevs, const BrokerOperation &operation)
+{
+    return runTasks(subdevs, [&](int subdev, const Progress &progress) -> ssize_t {
+        /* Requests on one connection are synchronous, so every camera gets its own */
+        auto broker = m_brokerSocket ? BrokerClient::connect(*m_brokerSocket) : std::nullopt;
+        if (!broker)
+            return -ECONNREFUSED;
+
+        return operation(*broker, subdev, progress);
+    });
+}
+
+std::vector<CameraResult> TransferEngine::runTasks(const std::vector<int> &subdevs, const CameraTask &task)
+{
+    std::vector<CameraResult> results(subdevs.size());
+    std::atomic<size_t> next{0};
+
+    auto const worker = [&] {
+        for (size_t i = next++; i < subdevs.size(); i = next++) {
+            auto const subdev = subdevs[i];
+            auto const start = std::chrono::steady_clock::now();
+
+            auto const res = task(subdev, [this, subdev](size_t done, size_t total) {
+                reportProgress(subdev, done, total);
+            });
+
+            results[i] = {subdev, res, std::chrono::steady_clock::now() - start};
+        }
+    };
+
+    auto const workerCount = std::min<size_t>(m_maxWorkers, subdevs.size());
+    std::vector<std::thread> workers;
+
+    for (size_t i = 1; i < workerCount; i++)
+        workers.emplace_back(worker);
+
+    /* The calling thread is one of the workers */
+    worker();
+
+    for (auto &thread : workers)
+        thread.join();
+
+    return results;
+}
+
+std::vector<CameraResult> TransferEngine::upload(const std::vector<int> &subdevs, FileSelector selector,
+                                                 const uint8_t *data, size_t length, bool sync)
+{
+    UploadOptions options;
+    options.mode = sync ? UploadMode::Content : UploadMode::Plain;
+
+    auto const upload = [&](const Progress &progress, auto &&transfer) -> ssize_t {
+        TransferControl control;
+        control.progress = [&progress](const TransferProgress &transferProgress) {
+            progress(transferProgress.done, transferProgress.total);
+        };
+
+        UploadResult result{};
+
+        auto const res = transfer(result, control);
+        if (res < 0)
+            return res;
+
+        /* Content uploads report no progress of their own */
+        progress(length, length);
+
+        return res;
+    };
+
+    if (m_brokerSocket) {
+        return runBrokered(subdevs, [&](BrokerClient &broker, int subdev, const Progress &progress) {
+            return upload(progress, [&](UploadResult &result, const TransferControl &control) {
+                return broker.upload(subdev, selector, data, length, options, result, control);
+            });
+        });
+    }
+
+    return run(subdevs, [&](AlviumGenCP &gencp, int, const Progress &progress) {
+        return upload(progress, [&](UploadResult &result, const TransferControl &control) {
+            return uploadFile(gencp, selector, data, length, options, result, control);
+        });
+    });
+}
+
+std::vector<CameraResult> TransferEngine::download(const std::vector<int> &subdevs, FileSelector selector,
+                                                   const std::function<FileSink(int subdev)> &sinkFactory)
+{
+    if (m_brokerSocket) {
+        return runBrokered(subdevs, [&](BrokerClient &broker, int subdev, const Progress &progress) -> ssize_t {
+            auto const sink = sinkFactory(subdev);
+            if (!sink)
+                return -1;
+
+            /* The broker hands over the whole payload at once */
+            auto const res = broker.readContent(subdev, selector, sink);
+            if (res >= 0)
+                progress(res, res);
+
+            return res;
+        });
+    }
+
+    return run(subdevs, [&](AlviumGenCP &gencp, int subdev, const Progress &progress) -> ssize_t {
+        auto file = File::open(gencp, selector, FileOpenMode::Read);
+        if (!file)
+            return -1;
+
+        auto const total = file->length();
+        if (total <= 0)
+            return total < 0 ? total : -1;
+
+        auto const sink = sinkFactory(subdev);
+        if (!sink)
+            return -1;
+
+        size_t done = 0;
+
+        auto const res = readContent(*file, [&](const uint8_t *data, size_t length) {
+            int const sinkRes = sink(data, length);
+
+            done += length;
+            progress(done, total);
+
+            return sinkRes;
+        });
+
+        /* total includes a content header the sink did not get */
+        if (res >= 0)
+            progress(total, total);
+
+        return res;
+    });
+}
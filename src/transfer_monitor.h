@@ -0,0 +1,57 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <chrono>
+
+#include <cerrno>
+
+#include <file_access.h>
+
+/* Applies a TransferControl after every chunk */
+class TransferMonitor {
+public:
+    /* startDone is where a continued transfer starts, the rate only counts what moved since */
+    TransferMonitor(const TransferControl &control, size_t total, size_t startDone = 0)
+        : m_control{control}, m_total{total}, m_startDone{startDone}, m_start{std::chrono::steady_clock::now()}
+    {
+
+    }
+
+    /* Returns -ECANCELED if the transfer should stop */
+    int update(size_t done)
+    {
+        if (m_control.progress) {
+            std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - m_start;
+            double const bytesPerSecond = elapsed.count() > 0 ? (done - m_startDone) / elapsed.count() : 0;
+
+            m_control.progress({done, m_total, bytesPerSecond});
+        }
+
+        if (m_control.cancelled && *m_control.cancelled && done < m_total)
+            return -ECANCELED;
+
+        return 0;
+    }
+private:
+    const TransferControl &m_control;
+    const size_t m_total;
+    const size_t m_startDone;
+    const std::chrono::steady_clock::time_point m_start;
+};
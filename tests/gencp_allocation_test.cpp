@@ -0,0 +1,127 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <array>
+#include <iostream>
+#include <vector>
+
+#include <cstdlib>
+
+#include <file_access.h>
+#include <gencp_sim.h>
+
+/*
+ * Runs register accesses, register batches larger than the initial batch
+ * capacity and file transfers on SimulatedTransport twice. The first round
+ * may size the session's buffers once per batch, the second must not
+ * allocate at all.
+ */
+
+static const size_t BatchLength = 64;
+/* Batch order and batch buffer */
+static const size_t MaxFirstRoundAllocations = 2;
+
+static int transfer(AlviumGenCP &gencp, const std::vector<uint8_t> &data, std::vector<uint8_t> &readBack)
+{
+    uint32_t value = 0;
+
+    if (gencp.readRegister(0x1000, reinterpret_cast<uint8_t*>(&value), sizeof(value)) < 0)
+        return -1;
+
+    value++;
+
+    if (gencp.writeRegister(0x1000, reinterpret_cast<const uint8_t*>(&value), sizeof(value)) < 0)
+        return -1;
+
+    std::array<uint32_t, BatchLength> values{};
+    std::array<RegisterRead, BatchLength> reads;
+    std::array<RegisterWrite, BatchLength> writes;
+
+    /* Every other register, so the batch needs more than one ReadMem */
+    for (size_t i = 0; i < BatchLength; i++) {
+        reads[i] = {0x2000 + 8 * i, reinterpret_cast<uint8_t*>(&values[i]), sizeof(values[i])};
+        writes[i] = {0x2000 + 8 * i, reinterpret_cast<const uint8_t*>(&values[i]), sizeof(values[i])};
+    }
+
+    if (gencp.readRegisters(reads.data(), reads.size()) < 0)
+        return -1;
+
+    for (auto &batchValue : values)
+        batchValue++;
+
+    if (gencp.writeRegisters(writes.data(), writes.size()) < 0)
+        return -1;
+
+    if (File::remove(gencp, FileSelector::UserData) < 0)
+        return -1;
+
+    {
+        auto file = File::open(gencp, FileSelector::UserData, FileOpenMode::Write);
+        if (!file || file->write(data.data(), data.size()) < 0)
+            return -1;
+    }
+
+    auto file = File::open(gencp, FileSelector::UserData, FileOpenMode::Read);
+    if (!file || file->read(readBack.data(), readBack.size()) != ssize_t(data.size()))
+        return -1;
+
+    return readBack == data ? 0 : -1;
+}
+
+int main()
+{
+    /* Keep the file cache out of the transfers */
+    setenv("ALVIUM_CACHE_DIR", "", 1);
+
+    auto gencp = AlviumGenCP::open(std::make_unique<SimulatedTransport>());
+    if (!gencp) {
+        std::cerr << "Failed to open the simulated session" << std::endl;
+        return 1;
+    }
+
+    std::vector<uint8_t> data(0x4000);
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = i * 7;
+
+    std::vector<uint8_t> readBack(data.size());
+    auto const openAllocations = gencp->allocationCount();
+
+    if (transfer(*gencp, data, readBack) < 0) {
+        std::cerr << "First round failed" << std::endl;
+        return 1;
+    }
+
+    auto const allocations = gencp->allocationCount();
+
+    if (allocations - openAllocations > MaxFirstRoundAllocations) {
+        std::cerr << "First round allocated " << allocations - openAllocations << " buffers" << std::endl;
+        return 1;
+    }
+
+    if (transfer(*gencp, data, readBack) < 0) {
+        std::cerr << "Second round failed" << std::endl;
+        return 1;
+    }
+
+    if (gencp->allocationCount() != allocations) {
+        std::cerr << "Transfers allocated " << gencp->allocationCount() - allocations << " buffers" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
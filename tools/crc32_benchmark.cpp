@@ -0,0 +1,111 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <cppcrc.h>
+
+#include <crc32.h>
+
+
+using CrcFunction = std::function<uint32_t(const uint8_t *data, size_t length)>;
+
+/* Throughput in MB/s of crc over buffer in blocks of blockSize */
+static double measure(const CrcFunction &crc, const std::vector<uint8_t> &buffer, size_t blockSize)
+{
+    volatile uint32_t result = 0;
+
+    using namespace std::chrono;
+
+    auto const start = steady_clock::now();
+    size_t total = 0;
+    unsigned rounds = 0;
+
+    do {
+        for (size_t offset = 0; offset + blockSize <= buffer.size(); offset += blockSize) {
+            result = result ^ crc(buffer.data() + offset, blockSize);
+            total += blockSize;
+        }
+
+        rounds++;
+    } while (steady_clock::now() - start < milliseconds(200) || rounds < 2);
+
+    auto const seconds = duration<double>(steady_clock::now() - start).count();
+
+    return total / seconds / 1e6;
+}
+
+int main()
+{
+    std::vector<uint8_t> buffer(4 << 20);
+
+    for (size_t i = 0; i < buffer.size(); i++)
+        buffer[i] = i * 2654435761u >> 24;
+
+    struct Candidate {
+        const char *name;
+        CrcFunction crc;
+    };
+
+    Candidate const candidates[] = {
+        {"cppcrc", [](const uint8_t *data, size_t length) { return CRC32::JAMCRC::calc(data, length); }},
+        {"slice-by-8", [](const uint8_t *data, size_t length) { return jamcrcPortable(data, length); }},
+        {jamcrcImplementation(), [](const uint8_t *data, size_t length) { return jamcrc(data, length); }},
+    };
+
+    /* A short command, a full mailbox packet and a streamed file */
+    size_t const blockSizes[] = {14, 1024, buffer.size()};
+
+    std::cout << std::left << std::setw(12) << "block";
+    for (auto const &candidate : candidates)
+        std::cout << std::setw(14) << candidate.name;
+    std::cout << " MB/s" << std::endl;
+
+    int res = 0;
+
+    for (auto const blockSize : blockSizes) {
+        std::cout << std::setw(12) << blockSize;
+
+        for (auto const &candidate : candidates) {
+            auto const throughput = measure(candidate.crc, buffer, blockSize);
+            std::cout << std::setw(14) << std::fixed << std::setprecision(1) << throughput;
+        }
+
+        std::cout << std::endl;
+    }
+
+    /* Odd lengths and offsets cover the tails around the vectorized blocks */
+    for (size_t length = 0; length < 300; length++) {
+        auto const data = buffer.data() + length % 7;
+        auto const reference = candidates[0].crc(data, length);
+
+        for (auto const &candidate : candidates) {
+            if (candidate.crc(data, length) != reference)
+                res = -1;
+        }
+    }
+
+    if (res < 0)
+        std::cerr << "Results differ from cppcrc!" << std::endl;
+
+    return res;
+}
@@ -0,0 +1,220 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <cctype>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <broker_client.h>
+#include <camera_discovery.h>
+#include <mapped_file.h>
+#include <transfer_engine.h>
+
+
+static void usage()
+{
+    std::cerr << "Usage: file_access_fleet [-j workers] [-s] -w data-file <camera>..." << std::endl
+              << "       file_access_fleet [-j workers] -r output-dir <camera>..." << std::endl
+              << "       file_access_fleet -l" << std::endl
+              << "A camera is a subdev index, \"all\" or \"sn:<serial>\"" << std::endl;
+}
+
+/* Digits only, std::nullopt for anything else or a value out of range */
+static std::optional<unsigned> parseWorkers(const char *text)
+{
+    unsigned workers = 0;
+    auto const end = text + strlen(text);
+
+    auto const [ptr, error] = std::from_chars(text, end, workers);
+    if (!::isdigit(static_cast<unsigned char>(text[0])) || error != std::errc{} || ptr != end)
+        return std::nullopt;
+
+    return workers;
+}
+
+/* One line with the progress of every camera, redrawn whenever a percentage changes */
+class ProgressLine {
+public:
+    void update(int subdev, size_t done, size_t total)
+    {
+        auto const percent = total > 0 ? unsigned(100 * done / total) : 100U;
+
+        auto &current = m_percent[subdev];
+        if (current == percent)
+            return;
+
+        current = percent;
+
+        std::cout << "\r";
+        for (auto const &[index, value] : m_percent)
+            std::cout << "subdev" << index << ": " << value << "%  ";
+        std::cout << std::flush;
+    }
+
+    void finish()
+    {
+        if (!m_percent.empty())
+            std::cout << std::endl;
+    }
+private:
+    std::map<int, unsigned> m_percent;
+};
+
+int main(int argc, char *argv[])
+{
+    int opt;
+
+    unsigned workers = 0;
+    bool sync = false;
+    bool list = false;
+    std::filesystem::path inputFilePath;
+    std::filesystem::path outputDir;
+
+    while ((opt = getopt(argc, argv, "j:sw:r:l")) != -1) {
+        switch (opt)
+        {
+        case 'j': {
+            auto const parsed = parseWorkers(optarg);
+            if (!parsed) {
+                usage();
+                return -1;
+            }
+
+            workers = *parsed;
+            break;
+        }
+        case 's':
+            sync = true;
+            break;
+        case 'w':
+            inputFilePath = optarg;
+            break;
+        case 'r':
+            outputDir = optarg;
+            break;
+        case 'l':
+            list = true;
+            break;
+        default:
+            usage();
+            return -1;
+        }
+    }
+
+    if (list) {
+        for (auto const &camera : discoverCameras(true)) {
+            std::cout << camera.subdev << "\t" << camera.name << "\t"
+                      << (camera.serial.empty() ? "-" : camera.serial) << std::endl;
+        }
+
+        return 0;
+    }
+
+    if (inputFilePath.empty() == outputDir.empty() || optind == argc) {
+        usage();
+        return -1;
+    }
+
+    std::vector<int> subdevs;
+
+    for (int i = optind; i < argc; i++) {
+        auto const targetSubdevs = resolveCameraTarget(argv[i]);
+        if (targetSubdevs.empty()) {
+            std::cerr << "No camera matches " << argv[i] << std::endl;
+            return -1;
+        }
+
+        for (auto const subdev : targetSubdevs) {
+            if (std::find(subdevs.begin(), subdevs.end(), subdev) == subdevs.end())
+                subdevs.push_back(subdev);
+        }
+    }
+
+    TransferEngine engine{workers};
+    ProgressLine progressLine;
+
+    /* A running broker owns the cameras, accessing them directly would disturb its requests */
+    if (BrokerClient::connect())
+        engine.setBrokerSocket(*brokerSocketPath());
+
+    engine.setProgressCallback([&progressLine](int subdev, size_t done, size_t total) {
+        progressLine.update(subdev, done, total);
+    });
+
+    std::vector<CameraResult> results;
+
+    if (!inputFilePath.empty()) {
+        /* All cameras upload from the same mapping */
+        auto const input = MappedFile::openRead(inputFilePath);
+        if (!input) {
+            std::cerr << "Failed to map " << inputFilePath << std::endl;
+            return -1;
+        }
+
+        results = engine.upload(subdevs, FileSelector::UserData, input->data(), input->size(), sync);
+    } else {
+        std::map<int, int> outputFds;
+
+        for (auto const subdev : subdevs) {
+            auto const outputPath = outputDir / ("subdev" + std::to_string(subdev) + ".bin");
+            auto const fd = ::open(outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+            if (fd < 0) {
+                std::cerr << "Failed to create " << outputPath << std::endl;
+                return -1;
+            }
+
+            outputFds[subdev] = fd;
+        }
+
+        results = engine.download(subdevs, FileSelector::UserData, [&outputFds](int subdev) {
+            return fileDescriptorSink(outputFds.at(subdev));
+        });
+
+        for (auto const &[subdev, fd] : outputFds)
+            ::close(fd);
+    }
+
+    progressLine.finish();
+
+    int res = 0;
+
+    for (auto const &result : results) {
+        auto const ms = std::chrono::duration_cast<std::chrono::milliseconds>(result.duration).count();
+
+        if (result.result < 0) {
+            std::cout << "subdev" << result.subdev << ": failed (" << result.result << ")" << std::endl;
+            res = -1;
+        } else {
+            std::cout << "subdev" << result.subdev << ": " << result.result << " bytes in " << ms << " ms" << std::endl;
+        }
+    }
+
+    return res;
+}
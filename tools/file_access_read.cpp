@@ -20,23 +20,79 @@
 #include <fstream>
 #include <filesystem>
 
+#include <cerrno>
 #include <cstring>
+#include <fcntl.h>
+#include <getopt.h>
 #include <unistd.h>
 
+#include <broker_client.h>
+#include <camera_discovery.h>
 #include <file_access.h>
+#include <file_archive.h>
+#include <file_cache.h>
+#include <file_compression.h>
+#include <file_content.h>
+#include <file_resume.h>
+#include <mapped_file.h>
+
+/* Events kept for -T, the most recent ones are written if a transfer needs more */
+static const size_t TraceCapacity = 1 << 18;
+
+/* stdout or the created output file, for data of unknown length */
+static int openOutput(const std::string &outputFile)
+{
+    if (outputFile.empty())
+        return STDOUT_FILENO;
+
+    int const fd = ::open(outputFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        std::cerr << "Failed to create " << outputFile << std::endl;
+
+    return fd;
+}
 
 int main(int argc, char **argv)
 {
     int opt;
 
     std::string outputFile{};
+    std::string entryName{};
+    bool useCache = false;
+    bool resume = false;
+    bool printStats = false;
+    std::string prometheusFile{};
+    std::string traceFile{};
 
-    while ((opt = getopt(argc, argv, "o:")) != -1) {
+    static const struct option longOptions[] = {
+        {"resume", no_argument, nullptr, 'R'},
+        {},
+    };
+
+    while ((opt = getopt_long(argc, argv, "o:e:cSP:T:", longOptions, nullptr)) != -1) {
         switch (opt)
         {
         case 'o':
             outputFile = optarg;
             break;
+        case 'e':
+            entryName = optarg;
+            break;
+        case 'c':
+            useCache = true;
+            break;
+        case 'R':
+            resume = true;
+            break;
+        case 'S':
+            printStats = true;
+            break;
+        case 'P':
+            prometheusFile = optarg;
+            break;
+        case 'T':
+            traceFile = optarg;
+            break;
         case '?':
             std::cerr << "Invalid usage" << std::endl;
             break;
@@ -50,33 +106,195 @@ int main(int argc, char **argv)
         return -1;
     }
 
-    auto alviumGenCP = AlviumGenCP::open(std::stoi(argv[optind]));
+    if (resume && (outputFile.empty() || !entryName.empty() || useCache)) {
+        std::cerr << "--resume needs -o and can not be combined with -e or -c" << std::endl;
+        return -1;
+    }
+
+    auto const subdev = resolveSingleCamera(argv[optind]);
+    if (!subdev)
+        return -1;
+
+    /* A running broker owns the camera, accessing it directly would disturb its requests */
+    auto broker = BrokerClient::connect();
+    if (broker) {
+        if (!traceFile.empty() || resume) {
+            std::cerr << "Tracing and --resume are not available through the broker" << std::endl;
+            return -1;
+        }
+
+        BrokerReadOptions options;
+        options.entry = entryName;
+        options.useCache = useCache || fileCacheEnabled();
+
+        int const fd = openOutput(outputFile);
+        if (fd < 0)
+            return -1;
+
+        bool cached = false;
+
+        /* Written straight from the broker's shared buffer */
+        auto const res = broker->readContent(*subdev, FileSelector::UserData, fileDescriptorSink(fd), options, &cached);
+
+        if (fd != STDOUT_FILENO)
+            ::close(fd);
+
+        if (res < 0) {
+            std::cerr << "Read failed" << std::endl;
+            return res;
+        }
+
+        if (cached)
+            std::cerr << "Using cached data" << std::endl;
+
+        GenCPStats stats{};
+
+        if ((printStats || !prometheusFile.empty()) && broker->stats(*subdev, stats) < 0)
+            return -1;
+
+        return reportStats(stats, *subdev, printStats, prometheusFile);
+    }
+
+    auto alviumGenCP = AlviumGenCP::open(*subdev);
     if (!alviumGenCP)
         return -1;
 
+    TraceRecorder trace{traceFile.empty() ? 1 : TraceCapacity};
+
+    if (!traceFile.empty())
+        alviumGenCP->setTraceRecorder(&trace);
+
+    if ((useCache || fileCacheEnabled()) && entryName.empty() && !resume) {
+        setFileCacheEnabled(true);
+
+        /* The decoded length is not known up front, so the output is written as the data arrives */
+        int const fd = openOutput(outputFile);
+        if (fd < 0)
+            return -1;
+
+        bool cached = false;
+
+        auto const res = readContentCached(*alviumGenCP, FileSelector::UserData, fileDescriptorSink(fd), &cached);
+
+        if (fd != STDOUT_FILENO)
+            ::close(fd);
+
+        if (res < 0) {
+            std::cerr << "Read failed" << std::endl;
+            return res;
+        }
+
+        if (cached)
+            std::cerr << "Using cached data" << std::endl;
+
+        return reportStats(alviumGenCP->stats(), *subdev, printStats, prometheusFile, &trace, traceFile);
+    }
+
     auto userDataFile = File::open(*alviumGenCP, FileSelector::UserData, FileOpenMode::Read);
     if (!userDataFile)
         return -1;
 
-    auto const length = userDataFile->length();
-    if (length < 0)
-        return length;
+    ssize_t res{};
 
-    auto buffer = std::make_unique<uint8_t[]>(length);
+    if (!entryName.empty()) {
+        /* Only the archive index and the range of the entry are read */
+        auto const index = readArchiveIndex(*userDataFile);
+        if (!index) {
+            std::cerr << "File is not an archive" << std::endl;
+            return -1;
+        }
 
-    auto const res = userDataFile->read(buffer.get(), length);
-    if (res < 0)
-        return res;
+        auto const entry = index->find(entryName);
+        if (!entry) {
+            std::cerr << "No entry " << entryName << std::endl;
+            return -ENOENT;
+        }
 
-    if (!outputFile.empty()) {
-        std::fstream stream{outputFile, std::fstream::out | std::fstream::trunc | std::fstream::binary};
-        stream.write(reinterpret_cast<char*>(buffer.get()), res);
-    } else {
-        ssize_t bytes_written = write(STDOUT_FILENO, buffer.get(), length);
-        if (bytes_written == -1) {
-            perror("write: fail");
+        if (!outputFile.empty()) {
+            auto output = MappedFile::create(outputFile, entry->length);
+            if (!output) {
+                std::cerr << "Failed to create " << outputFile << std::endl;
+                return -1;
+            }
+
+            size_t written = 0;
+
+            res = readArchiveEntry(*userDataFile, *entry, [&](const uint8_t *data, size_t length) {
+                memcpy(output->data() + written, data, length);
+                written += length;
+                return 0;
+            });
+        } else {
+            res = readArchiveEntry(*userDataFile, *entry, fileDescriptorSink(STDOUT_FILENO));
         }
+    } else if (!outputFile.empty()) {
+        auto const fileLength = userDataFile->length();
+        if (fileLength <= 0)
+            return -1;
+
+        auto const compressed = readCompressedHeader(*userDataFile);
+        auto const content = compressed ? std::nullopt : readContentHeader(*userDataFile);
+
+        /* Compressed files output their raw data, files with a content header only their payload */
+        uint32_t const offset = content ? content->header.headerLength : 0;
+        size_t const length = compressed ? compressed->rawLength
+                            : content ? content->header.payloadLength : fileLength;
+
+        if (resume) {
+            if (compressed) {
+                std::cerr << "--resume does not support compressed files" << std::endl;
+                return -1;
+            }
+
+            /* downloadResumable opens the file itself */
+            userDataFile.reset();
+
+            uint32_t crc = 0;
+            bool resumed = false;
+
+            res = downloadResumable(*alviumGenCP, FileSelector::UserData, offset, length, outputFile, crc, {}, &resumed);
+
+            if (resumed)
+                std::cerr << "Resumed an interrupted download" << std::endl;
+
+            if (res >= 0 && content && crc != content->header.payloadCrc)
+                res = -EBADMSG;
+        } else {
+            /* Chunks are received directly into the mapped output file */
+            auto output = MappedFile::create(outputFile, length);
+            if (!output) {
+                std::cerr << "Failed to create " << outputFile << std::endl;
+                return -1;
+            }
+
+            if (compressed) {
+                size_t written = 0;
+
+                res = readCompressed(*userDataFile, [&](const uint8_t *data, size_t blockLength) {
+                    memcpy(output->data() + written, data, blockLength);
+                    written += blockLength;
+                    return 0;
+                });
+            } else {
+                res = userDataFile->pread(offset, output->data(), output->size());
+
+                /* pread computes the CRC as the chunks arrive */
+                if (res >= 0 && content && (size_t(res) != length || userDataFile->crc() != content->header.payloadCrc))
+                    res = -EBADMSG;
+            }
+        }
+    } else {
+        /* Chunks are passed on as soon as they arrive */
+        res = readContent(*userDataFile, fileDescriptorSink(STDOUT_FILENO));
     }
 
-    return 0;
+    if (res < 0) {
+        std::cerr << "Read failed" << std::endl;
+        return res;
+    }
+
+    /* Closed first so the close operation is part of the stats */
+    userDataFile.reset();
+
+    return reportStats(alviumGenCP->stats(), *subdev, printStats, prometheusFile, &trace, traceFile);
 }
\ No newline at end of file
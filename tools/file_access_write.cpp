@@ -21,70 +21,205 @@
 #include <fstream>
 #include <filesystem>
 
+#include <cerrno>
 #include <cstring>
+#include <getopt.h>
+#include <unistd.h>
+
+#include <broker_client.h>
+#include <camera_discovery.h>
 #include <file_access.h>
+#include <file_upload.h>
+#include <mapped_file.h>
+
+
+/* Events kept for -T, the most recent ones are written if a transfer needs more */
+static const size_t TraceCapacity = 1 << 18;
+
+static void printResult(const UploadOptions &options, const UploadResult &result)
+{
+    switch (result.action) {
+    case UploadAction::Unchanged:
+        std::cout << "Camera already holds this " << (options.mode == UploadMode::ArchiveEntry ? "entry" : "file")
+                  << std::endl;
+        break;
+    case UploadAction::Patched:
+        std::cout << "Patched: " << result.bytesWritten << " bytes written" << std::endl;
+        break;
+    case UploadAction::Written:
+        if (options.mode == UploadMode::Compressed)
+            std::cout << "Compressed: " << result.bytesWritten << " bytes stored" << std::endl;
+        else if (options.mode == UploadMode::ArchiveEntry)
+            std::cout << "Archive rewritten: " << result.bytesWritten << " bytes" << std::endl;
+        else if (options.mode == UploadMode::Content)
+            std::cout << "Written: " << result.bytesWritten << " bytes" << std::endl;
+        break;
+    }
 
+    if (options.verify && result.action != UploadAction::Unchanged)
+        std::cout << "Verified" << std::endl;
 
+    if (result.bytesRepaired > 0)
+        std::cout << "Repaired: " << result.bytesRepaired << " bytes" << std::endl;
+}
 
 int main(int argc, char *argv[])
 {
-    if (argc != 3) {
+    int opt;
+
+    bool sync = false;
+    bool verify = false;
+    bool compress = false;
+    std::string entryName{};
+    bool resume = false;
+    bool printStats = false;
+    std::string prometheusFile{};
+    std::string traceFile{};
+
+    static const struct option longOptions[] = {
+        {"resume", no_argument, nullptr, 'R'},
+        {},
+    };
+
+    while ((opt = getopt_long(argc, argv, "svze:SP:T:", longOptions, nullptr)) != -1) {
+        switch (opt)
+        {
+        case 's':
+            sync = true;
+            break;
+        case 'v':
+            verify = true;
+            break;
+        case 'z':
+            compress = true;
+            break;
+        case 'e':
+            entryName = optarg;
+            break;
+        case 'R':
+            resume = true;
+            break;
+        case 'S':
+            printStats = true;
+            break;
+        case 'P':
+            prometheusFile = optarg;
+            break;
+        case 'T':
+            traceFile = optarg;
+            break;
+        case '?':
+            std::cerr << "Invalid usage" << std::endl;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (optind != argc - 2) {
         std::cerr << "Invalid usage!" << std::endl;
         return -1;
     }
 
+    if (int(sync) + int(compress) + int(!entryName.empty()) > 1) {
+        std::cerr << "-s, -z and -e can not be combined" << std::endl;
+        return -1;
+    }
+
+    if (resume && (sync || compress || !entryName.empty())) {
+        std::cerr << "--resume only applies to plain uploads" << std::endl;
+        return -1;
+    }
 
+    auto const subdev = resolveSingleCamera(argv[optind]);
+    if (!subdev)
+        return -1;
 
-    auto const inputFilePath = std::filesystem::path{argv[2]};
+    auto const inputFilePath = std::filesystem::path{argv[optind + 1]};
 
     if (!std::filesystem::exists(inputFilePath))
         return -1;
 
-    auto alviumGenCP = AlviumGenCP::open(std::stoi(argv[1]));
-
-    auto const currentLength = [&]() -> int {
-        auto userDataFileRead = File::open(*alviumGenCP, FileSelector::UserData, FileOpenMode::Read);
-        if (!userDataFileRead) {
-            std::cerr << "Open failed" << std::endl;
-            return -1;
-        }
+    /* Upload straight from the mapping, the input is never copied */
+    auto const input = MappedFile::openRead(inputFilePath);
+    if (!input) {
+        std::cerr << "Failed to map " << inputFilePath << std::endl;
+        return -1;
+    }
 
-        return userDataFileRead->length();
-    }();
+    UploadOptions options;
+    options.mode = sync ? UploadMode::Content
+                 : compress ? UploadMode::Compressed
+                 : !entryName.empty() ? UploadMode::ArchiveEntry : UploadMode::Plain;
+    options.verify = verify;
+    options.entry = entryName;
+    options.resume = resume;
 
-    if (currentLength < 0) {
+    if (options.mode != UploadMode::ArchiveEntry && input->size() == 0) {
+        std::cerr << "File to write is empty" << std::endl;
         return -1;
     }
 
-    if (currentLength > 0) {
-        auto const  res = File::remove(*alviumGenCP, FileSelector::UserData);
+    UploadResult result{};
+
+    TransferControl control;
+    control.progress = [](const TransferProgress &progress) {
+        auto const percent = (100 * progress.done) / progress.total;
+        auto const done = progress.done == progress.total;
+
+        std::cout << (done ? "Written: " : "Writing: ") << percent << "% ("
+                  << progress.done << "/" << progress.total << ", "
+                  << unsigned(progress.bytesPerSecond) << " B/s)" << (done ? "\n" : "\r") << std::flush;
+    };
+
+    /* A running broker owns the camera, accessing it directly would disturb its requests */
+    auto broker = BrokerClient::connect();
+    if (broker) {
+        if (!traceFile.empty()) {
+            std::cerr << "Tracing is not available through the broker" << std::endl;
+            return -1;
+        }
+
+        if (options.mode == UploadMode::Plain || options.mode == UploadMode::Compressed)
+            std::cout << "File length: " << input->size() << std::endl;
+
+        auto const res = broker->upload(*subdev, FileSelector::UserData, input->data(), input->size(), options,
+                                        result, control);
         if (res < 0) {
-            std::cerr << "File remove failed" << std::endl;
+            std::cerr << "Upload failed" << std::endl;
             return res;
         }
-    }
 
-    auto userDataFile = File::open(*alviumGenCP, FileSelector::UserData, FileOpenMode::Write);
-    if (!userDataFile) {
-        std::cerr << "Open failed" << std::endl;
-        return -1;
+        printResult(options, result);
+
+        GenCPStats stats{};
+
+        if ((printStats || !prometheusFile.empty()) && broker->stats(*subdev, stats) < 0)
+            return -1;
+
+        return reportStats(stats, *subdev, printStats, prometheusFile);
     }
 
-    auto const length = std::filesystem::file_size(inputFilePath);
-    if (length == 0) {
-        std::cerr << "File to write is empty" << std::endl;
+    auto alviumGenCP = AlviumGenCP::open(*subdev);
+    if (!alviumGenCP)
         return -1;
-    }
 
-    std::cout << "File length: " << length << std::endl;
-    auto buffer = std::make_unique<uint8_t[]>(length);
+    TraceRecorder trace{traceFile.empty() ? 1 : TraceCapacity};
+
+    if (!traceFile.empty())
+        alviumGenCP->setTraceRecorder(&trace);
 
-    std::fstream stream{inputFilePath, std::fstream::in | std::fstream::binary};
-    stream.read(reinterpret_cast<char*>(buffer.get()), length);
+    if (options.mode == UploadMode::Plain || options.mode == UploadMode::Compressed)
+        std::cout << "File length: " << input->size() << std::endl;
 
-    auto const res = userDataFile->write(buffer.get(), length, true);
-    if (res < 0)
+    auto const res = uploadFile(*alviumGenCP, FileSelector::UserData, input->data(), input->size(),
+                                options, result, control);
+    if (res < 0) {
+        std::cerr << "Upload failed" << std::endl;
         return res;
+    }
+
+    printResult(options, result);
 
-    return 0;
-}
\ No newline at end of file
+    return reportStats(alviumGenCP->stats(), *subdev, printStats, prometheusFile, &trace, traceFile);
+}
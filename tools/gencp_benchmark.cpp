@@ -0,0 +1,418 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include <crc32.h>
+#include <file_access.h>
+#include <gencp_sim.h>
+
+/*
+ * Benchmarks of the GenCP and file access layers against SimulatedTransport.
+ * Besides the time per operation every case counts the raw transport
+ * transactions and bytes. These do not depend on the host, so any increase
+ * over the baseline is reported. Times may vary by the tolerance and are
+ * only compared against a baseline taken on the same kind of host.
+ */
+
+struct Result {
+    double timeUs;          /* per operation */
+    double transactions;    /* per operation */
+    double bytes;           /* per operation */
+};
+
+using Results = std::map<std::string, Result>;
+
+struct Baseline {
+    std::string config;
+    std::string host;
+    Results results;
+};
+
+static std::string configString(const SimulatedTransport::Config &config)
+{
+    std::ostringstream stream;
+
+    stream << "latency_ns=" << config.transactionLatency.count()
+           << " byte_latency_ns=" << config.byteLatency.count()
+           << " processing_ns=" << config.processingTime.count();
+
+    return stream.str();
+}
+
+/* CPU model and CRC implementation, the times of other hosts are not comparable */
+static std::string hostString()
+{
+    std::ostringstream stream;
+    struct utsname name{};
+
+    if (uname(&name) == 0)
+        stream << "machine=" << name.machine;
+
+    std::ifstream cpuinfo{"/proc/cpuinfo"};
+    std::string line;
+    std::string cpu;
+
+    /* x86 names the model, ARM only gives implementer and part numbers */
+    while (std::getline(cpuinfo, line)) {
+        auto const colon = line.find(':');
+        if (colon == std::string::npos || colon + 2 > line.size())
+            continue;
+
+        auto key = line.substr(0, colon);
+        key.erase(key.find_last_not_of(" \t") + 1);
+
+        if (key == "model name") {
+            cpu = line.substr(colon + 2);
+            break;
+        }
+
+        if ((key == "CPU implementer" || key == "CPU part") && cpu.find(key) == std::string::npos)
+            cpu += (cpu.empty() ? "" : ",") + key + "=" + line.substr(colon + 2);
+    }
+
+    stream << " cpu=\"" << cpu << "\" crc=" << jamcrcImplementation();
+
+    return stream.str();
+}
+
+class Benchmark {
+public:
+    explicit Benchmark(const SimulatedTransport::Config &config) : m_config{config}
+    {
+
+    }
+
+    void run()
+    {
+        registerAccess();
+        openClose();
+
+        for (auto const transferSize : {256UL, 512UL, 1024UL}) {
+            for (auto const blobSize : {0x400UL, 0x4000UL, 0xF000UL})
+                fileTransfer(transferSize, blobSize);
+        }
+
+        crc();
+    }
+
+    const Results &results() const
+    {
+        return m_results;
+    }
+
+    const std::set<std::string> &failures() const
+    {
+        return m_failures;
+    }
+private:
+    struct Session {
+        SimulatedTransport *sim;
+        std::optional<AlviumGenCP> gencp;
+    };
+
+    Session open(size_t maxTransferSize = 1024)
+    {
+        auto config = m_config;
+        config.maxTransferSize = maxTransferSize;
+
+        auto transport = std::make_unique<SimulatedTransport>(config);
+        auto const sim = transport.get();
+
+        return {sim, AlviumGenCP::open(std::move(transport))};
+    }
+
+    /* Runs operation count times and records the averages or the failure under name */
+    template<typename Operation>
+    void measure(const std::string &name, Session &session, unsigned count, Operation operation)
+    {
+        if (!session.gencp) {
+            std::cerr << name << " failed to open the session" << std::endl;
+            m_failures.insert(name);
+            return;
+        }
+
+        auto const transactions = session.sim->transactionCount();
+        auto const bytes = session.sim->bytesTransferred();
+        auto const start = std::chrono::steady_clock::now();
+
+        for (unsigned i = 0; i < count; i++) {
+            if (operation() < 0) {
+                std::cerr << name << " failed" << std::endl;
+                m_failures.insert(name);
+                return;
+            }
+        }
+
+        std::chrono::duration<double, std::micro> const elapsed = std::chrono::steady_clock::now() - start;
+
+        m_results[name] = {
+            elapsed.count() / count,
+            double(session.sim->transactionCount() - transactions) / count,
+            double(session.sim->bytesTransferred() - bytes) / count,
+        };
+    }
+
+    void registerAccess()
+    {
+        auto session = open();
+        uint32_t value = 0;
+
+        measure("register_read", session, 200, [&] {
+            return session.gencp->readRegister(0x1000, reinterpret_cast<uint8_t*>(&value), sizeof(value));
+        });
+
+        measure("register_write", session, 200, [&] {
+            value++;
+            return session.gencp->writeRegister(0x1000, reinterpret_cast<const uint8_t*>(&value), sizeof(value));
+        });
+    }
+
+    void openClose()
+    {
+        auto session = open();
+
+        measure("file_open_close", session, 50, [&] {
+            return File::open(*session.gencp, FileSelector::UserData, FileOpenMode::Read) ? 0 : -1;
+        });
+    }
+
+    void fileTransfer(size_t transferSize, size_t blobSize)
+    {
+        auto session = open(transferSize);
+        auto const suffix = "_" + std::to_string(blobSize) + "_chunk" + std::to_string(transferSize);
+
+        std::vector<uint8_t> blob(blobSize);
+        for (size_t i = 0; i < blob.size(); i++)
+            blob[i] = i * 7;
+
+        measure("file_write" + suffix, session, 3, [&] {
+            auto &stored = session.sim->file(uint32_t(FileSelector::UserData));
+            stored.clear();
+
+            auto file = File::open(*session.gencp, FileSelector::UserData, FileOpenMode::Write);
+            return file ? file->write(blob.data(), blob.size()) : -1;
+        });
+
+        std::vector<uint8_t> readBack(blobSize);
+
+        measure("file_read" + suffix, session, 3, [&] {
+            auto file = File::open(*session.gencp, FileSelector::UserData, FileOpenMode::Read);
+            return file ? file->read(readBack.data(), readBack.size()) : -1;
+        });
+    }
+
+    void crc()
+    {
+        std::vector<uint8_t> buffer(1024);
+        for (size_t i = 0; i < buffer.size(); i++)
+            buffer[i] = i * 13;
+
+        volatile uint32_t result = 0;
+        auto const count = 100000;
+        auto const start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < count; i++)
+            result = result ^ jamcrc(buffer.data(), buffer.size());
+
+        std::chrono::duration<double, std::micro> const elapsed = std::chrono::steady_clock::now() - start;
+
+        m_results["crc_1024"] = {elapsed.count() / count, 0, 0};
+    }
+
+    const SimulatedTransport::Config m_config;
+    Results m_results;
+    std::set<std::string> m_failures;
+};
+
+static const std::string HostPrefix = "# host ";
+
+static int writeBaseline(const std::string &path, const std::string &config, const std::string &host,
+                         const Results &results)
+{
+    std::ofstream stream{path};
+
+    stream << "# " << config << std::endl << HostPrefix << host << std::endl << std::setprecision(10);
+
+    for (auto const &[name, result] : results)
+        stream << name << " " << result.timeUs << " " << result.transactions << " " << result.bytes << std::endl;
+
+    return stream ? 0 : -1;
+}
+
+static std::optional<Baseline> readBaseline(const std::string &path)
+{
+    std::ifstream stream{path};
+    if (!stream)
+        return std::nullopt;
+
+    Baseline baseline;
+    std::string line;
+
+    while (std::getline(stream, line)) {
+        if (line.compare(0, HostPrefix.size(), HostPrefix) == 0) {
+            baseline.host = line.substr(HostPrefix.size());
+            continue;
+        }
+
+        if (line.compare(0, 2, "# ") == 0) {
+            baseline.config = line.substr(2);
+            continue;
+        }
+
+        std::istringstream lineStream{line};
+        std::string name;
+        Result result{};
+
+        if (lineStream >> name >> result.timeUs >> result.transactions >> result.bytes)
+            baseline.results[name] = result;
+    }
+
+    return baseline;
+}
+
+/* Returns the number of regressions, a case of the baseline without result is one */
+static int compare(const Baseline &baseline, const std::string &config, const std::string &host,
+                   const Results &results, double tolerance)
+{
+    auto const compareTimes = baseline.config == config && baseline.host == host;
+    int regressions = 0;
+
+    if (baseline.config != config)
+        std::cout << "Baseline was taken with " << baseline.config << ", only comparing transfers" << std::endl;
+    else if (baseline.host.empty())
+        std::cout << "Baseline does not record its host, only comparing transfers" << std::endl;
+    else if (baseline.host != host)
+        std::cout << "Baseline was taken on another host (" << baseline.host << "), only comparing transfers"
+                  << std::endl;
+
+    for (auto const &[name, base] : baseline.results) {
+        auto const it = results.find(name);
+        if (it == results.end()) {
+            std::cout << "REGRESSION " << name << ": no result" << std::endl;
+            regressions++;
+            continue;
+        }
+
+        auto const &result = it->second;
+
+        /* Averages are stored rounded, anything below one unit is not a change */
+        if (result.transactions > base.transactions + 0.5 || result.bytes > base.bytes + 0.5) {
+            std::cout << "REGRESSION " << name << ": " << result.transactions << " transactions, "
+                      << result.bytes << " bytes (baseline " << base.transactions << ", " << base.bytes << ")"
+                      << std::endl;
+            regressions++;
+        }
+
+        if (compareTimes && result.timeUs > base.timeUs * (1 + tolerance)) {
+            std::cout << "REGRESSION " << name << ": " << result.timeUs << " us (baseline "
+                      << base.timeUs << " us)" << std::endl;
+            regressions++;
+        }
+    }
+
+    return regressions;
+}
+
+static void usage()
+{
+    std::cerr << "Usage: gencp_benchmark [-l latency_us] [-b byte_latency_ns] [-p processing_us]" << std::endl
+              << "                       [-o baseline-file] [-c baseline-file] [-t tolerance_percent]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    int opt;
+
+    SimulatedTransport::Config config{};
+    std::string outputBaseline;
+    std::string compareBaseline;
+    double tolerance = 0.25;
+
+    while ((opt = getopt(argc, argv, "l:b:p:o:c:t:")) != -1) {
+        switch (opt)
+        {
+        case 'l':
+            config.transactionLatency = std::chrono::microseconds(std::stoul(optarg));
+            break;
+        case 'b':
+            config.byteLatency = std::chrono::nanoseconds(std::stoul(optarg));
+            break;
+        case 'p':
+            config.processingTime = std::chrono::microseconds(std::stoul(optarg));
+            break;
+        case 'o':
+            outputBaseline = optarg;
+            break;
+        case 'c':
+            compareBaseline = optarg;
+            break;
+        case 't':
+            tolerance = std::stod(optarg) / 100;
+            break;
+        default:
+            usage();
+            return -1;
+        }
+    }
+
+    Benchmark benchmark{config};
+    benchmark.run();
+
+    std::cout << std::left << std::setw(32) << "case" << std::right
+              << std::setw(12) << "us/op" << std::setw(14) << "transactions" << std::setw(12) << "bytes" << std::endl;
+
+    for (auto const &[name, result] : benchmark.results()) {
+        std::cout << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << result.timeUs
+                  << std::setprecision(1) << std::setw(14) << result.transactions
+                  << std::setw(12) << result.bytes << std::endl;
+    }
+
+    auto const configText = configString(config);
+    auto const hostText = hostString();
+
+    if (!outputBaseline.empty() && writeBaseline(outputBaseline, configText, hostText, benchmark.results()) < 0) {
+        std::cerr << "Failed to write " << outputBaseline << std::endl;
+        return -1;
+    }
+
+    if (!compareBaseline.empty()) {
+        auto const baseline = readBaseline(compareBaseline);
+        if (!baseline) {
+            std::cerr << "Failed to read " << compareBaseline << std::endl;
+            return -1;
+        }
+
+        if (compare(*baseline, configText, hostText, benchmark.results(), tolerance) > 0)
+            return 1;
+    }
+
+    return benchmark.failures().empty() ? 0 : 1;
+}
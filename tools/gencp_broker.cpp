@@ -0,0 +1,87 @@
+/* alvium file access example - Example tool for accessing user data files in Alvium CSI2 cameras
+ * Copyright (C) 2024 Allied Vision Technologies GmbH
+
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <iostream>
+#include <thread>
+
+#include <cstring>
+
+#include <signal.h>
+#include <unistd.h>
+
+#include <broker_client.h>
+#include <gencp_broker.h>
+
+int main(int argc, char **argv)
+{
+    int opt;
+
+    std::optional<std::filesystem::path> socketPath = brokerSocketPath();
+
+    while ((opt = getopt(argc, argv, "s:")) != -1) {
+        switch (opt)
+        {
+        case 's':
+            socketPath = optarg;
+            break;
+        case '?':
+            std::cerr << "Invalid usage" << std::endl;
+            return -1;
+        default:
+            break;
+        }
+    }
+
+    if (!socketPath || socketPath->empty()) {
+        std::cerr << "No broker socket configured" << std::endl;
+        return -1;
+    }
+
+    /* Handled by sigwait below, the threads started from here inherit the mask */
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    Broker broker{*socketPath};
+
+    int res = broker.listen();
+    if (res < 0) {
+        std::cerr << "Failed to listen on " << *socketPath << ": " << strerror(-res) << std::endl;
+        return res;
+    }
+
+    std::cerr << "Listening on " << *socketPath << std::endl;
+
+    std::thread server{[&] {
+        res = broker.run();
+
+        /* Wake up sigwait if serving failed */
+        if (res < 0)
+            ::kill(::getpid(), SIGTERM);
+    }};
+
+    int signal;
+    sigwait(&signals, &signal);
+
+    broker.stop();
+    server.join();
+
+    return res;
+}